@@ -0,0 +1,402 @@
+/**********************************************************************
+ *  restore-bench.cpp
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+// Times restore-gui against checkpoint repositories: the read queries of every available git backend, and with
+// --generate the operations behind the GUI (refresh, selecting a checkpoint, diff, snapshot, restoring files)
+// on a synthetic repository of the requested size.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "changesmodel.h"
+#include "git.h"
+#include "gitbackend.h"
+#include "jobqueue.h"
+#include "synthrepo.h"
+
+namespace
+{
+constexpr int FirstPage = 100; // CheckpointModel::PageSize, what the GUI loads first
+constexpr int RestoredFiles = 100;
+
+struct Sample {
+    QString backend;
+    QString query;
+    qint64 minUs {0};
+    qint64 medianUs {0};
+    qint64 maxUs {0};
+    qint64 bytes {0};
+    qint64 items {0};
+    int iterations {0};
+    bool ok {true};
+
+    void setTimes(QList<qint64> times)
+    {
+        std::sort(times.begin(), times.end());
+        minUs = times.constFirst();
+        medianUs = times.at(times.size() / 2);
+        maxUs = times.constLast();
+        iterations = static_cast<int>(times.size());
+    }
+
+    [[nodiscard]] QJsonObject toJson() const
+    {
+        return {{"backend", backend},
+                {"query", query},
+                {"min_us", minUs},
+                {"median_us", medianUs},
+                {"max_us", maxUs},
+                {"bytes", bytes},
+                {"items", items},
+                {"iterations", iterations},
+                {"ok", ok}};
+    }
+};
+
+// Run through a JobQueue like the application does, so the numbers include the same overhead
+Sample measure(JobQueue &jobs, const QString &dir, const JobCommand &command, int iterations)
+{
+    QList<qint64> times;
+    Sample sample;
+    for (int i = 0; i < iterations; ++i) {
+        QEventLoop loop;
+        JobResult result;
+        QElapsedTimer timer;
+        timer.start();
+        jobs.enqueue(dir, QString(), JobQueue::Priority::High, {command}, &loop,
+                     [&result, &loop](const QList<JobResult> &results) {
+                         result = results.constFirst();
+                         loop.quit();
+                     });
+        loop.exec();
+        times.append(timer.nsecsElapsed() / 1000);
+        sample.ok = sample.ok && result.ok();
+        sample.bytes = result.out.size();
+    }
+    sample.setTimes(times);
+    return sample;
+}
+
+QList<Sample> compareBackends(const QString &dir, int iterations)
+{
+    QList<Sample> samples;
+    JobQueue jobs;
+    for (const QString &name : GitBackend::available()) {
+        const auto backend = GitBackend::create(name);
+        const QList<QPair<QString, JobCommand>> queries {
+            {"config", backend->configCommand("user.name")},
+            {"branch", backend->currentBranchCommand()},
+            {"log", backend->logCommand(0, -1)},
+            {"log-page", backend->logCommand(0, FirstPage)},
+            {"status", backend->statusCommand()},
+            {"tree-diff", backend->treeDiffCommand("HEAD~1")},
+            {"ls-tree", backend->listTreeCommand("HEAD")},
+            {"diff", backend->diffCommand("HEAD", {})},
+        };
+        for (const auto &[query, command] : queries) {
+            Sample sample = measure(jobs, dir, command, iterations);
+            sample.backend = name;
+            sample.query = query;
+            samples.append(sample);
+        }
+    }
+    return samples;
+}
+
+// Completes when pending async callbacks have all run, some of which may already have before exec()
+class Waiter
+{
+public:
+    explicit Waiter(int pending)
+        : pending(pending)
+    {
+    }
+    void done()
+    {
+        if (--pending == 0) {
+            loop.quit();
+        }
+    }
+    void exec()
+    {
+        if (pending > 0) {
+            loop.exec();
+        }
+    }
+    QEventLoop loop;
+
+private:
+    int pending;
+};
+
+// The GUI's sequence for one visit of the directory: edits made since the last checkpoint are picked up,
+// an older checkpoint is selected and diffed, a snapshot is taken and some files are restored from it.
+// Every iteration adds two checkpoints to the repository.
+QList<Sample> runScenario(const QString &dir, const SynthRepo::Options &options, int iterations)
+{
+    const QStringList names {"refresh", "display-changes", "select-checkpoint", "diff", "snapshot", "restore-files"};
+    QHash<QString, QList<qint64>> times;
+    QHash<QString, Sample> samples;
+    QRandomGenerator random(options.seed + 1);
+    QElapsedTimer timer;
+    const auto record = [&](const QString &name, bool ok, qsizetype items, qsizetype bytes = 0) {
+        times[name].append(timer.nsecsElapsed() / 1000);
+        Sample &sample = samples[name];
+        sample.ok = sample.ok && ok;
+        sample.items = items;
+        sample.bytes = bytes;
+    };
+
+    for (int i = 0; i < iterations; ++i) {
+        SynthRepo::modify(dir, options, options.churn, random);
+        Git git; // nothing cached, as after starting the application
+        ChangesModel model;
+
+        WorktreeStatus worktree;
+        QStringList page;
+        bool pageOk = false;
+        timer.start();
+        {
+            Waiter waiter(2);
+            git.scanWorktreeAsync(&waiter.loop, [&](const WorktreeStatus &status) {
+                worktree = status;
+                waiter.done();
+            });
+            git.listCommitsAsync(0, FirstPage, &waiter.loop, [&](bool ok, const QStringList &commits) {
+                pageOk = ok;
+                page = commits;
+                waiter.done();
+            });
+            waiter.exec();
+        }
+        record("refresh", worktree.isRepo && pageOk, page.size());
+
+        timer.start();
+        {
+            Waiter waiter(1);
+            git.getStatusAsync(worktree.headOid, worktree, &waiter.loop, [&](const ChangeList &changes) {
+                model.setChanges(changes);
+                waiter.done();
+            });
+            waiter.exec();
+        }
+        record("display-changes", true, model.rowCount());
+
+        // The oldest checkpoint on the first page, the furthest one can go without scrolling
+        const QString commit = page.isEmpty() ? QString() : page.constLast().section('|', 0, 0);
+        ChangeList selected;
+        timer.start();
+        {
+            Waiter waiter(1);
+            git.getStatusAsync(commit, worktree, &waiter.loop, [&](const ChangeList &changes) {
+                model.setChanges(changes);
+                selected = changes;
+                waiter.done();
+            });
+            waiter.exec();
+        }
+        record("select-checkpoint", !commit.isEmpty(), model.rowCount());
+
+        qsizetype diffBytes = 0;
+        qsizetype diffLines = 0;
+        bool diffOk = false;
+        timer.start();
+        {
+            Waiter waiter(1);
+            git.diffAsync(
+                commit, {}, &waiter.loop,
+                [&](const QByteArray &chunk) {
+                    diffBytes += chunk.size();
+                    diffLines += chunk.count('\n');
+                },
+                [&](bool ok, const QString &) {
+                    diffOk = ok;
+                    waiter.done();
+                });
+            waiter.exec();
+        }
+        record("diff", diffOk, diffLines, diffBytes);
+
+        timer.start();
+        const bool snapshotOk = git.commit({}, QStringLiteral("Benchmark checkpoint"));
+        record("snapshot", snapshotOk, worktree.tracked.size() + worktree.untracked.size());
+
+        QStringList files;
+        for (qsizetype i = 0; i < selected.size() && files.size() < RestoredFiles; ++i) {
+            files.append(selected.path(i));
+        }
+        timer.start();
+        const bool restoreOk = git.revertFiles(commit, files);
+        record("restore-files", restoreOk, files.size());
+    }
+
+    QList<Sample> result;
+    for (const QString &name : names) {
+        Sample sample = samples.value(name);
+        sample.backend = GitBackend::preferred();
+        sample.query = name;
+        sample.setTimes(times.value(name));
+        result.append(sample);
+    }
+    return result;
+}
+
+QString gitVersion()
+{
+    QProcess proc;
+    proc.start("git", {"--version"});
+    proc.waitForFinished();
+    return QString::fromUtf8(proc.readAllStandardOutput()).trimmed();
+}
+
+void printTable(QTextStream &out, const QList<Sample> &samples)
+{
+    out << QString("%1 %2 %3 %4 %5 %6\n")
+               .arg(QStringLiteral("backend"), -8)
+               .arg(QStringLiteral("query"), -18)
+               .arg(QStringLiteral("min us"), 10)
+               .arg(QStringLiteral("median us"), 10)
+               .arg(QStringLiteral("max us"), 10)
+               .arg(QStringLiteral("bytes"), 10);
+    for (const Sample &sample : samples) {
+        out << QString("%1 %2 %3 %4 %5 %6%7\n")
+                   .arg(sample.backend, -8)
+                   .arg(sample.query, -18)
+                   .arg(sample.minUs, 10)
+                   .arg(sample.medianUs, 10)
+                   .arg(sample.maxUs, 10)
+                   .arg(sample.bytes, 10)
+                   .arg(sample.ok ? QString() : QStringLiteral("  (failed)"));
+    }
+    out.flush();
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("restore-bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measure restore-gui on an existing or a generated repository"));
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"n", "iterations"}, QStringLiteral("Runs per query (default 10)"), "count", "10"},
+        {"generate", QStringLiteral("Generate a synthetic repository in <dir> (default: a temporary directory) "
+                                    "and also time the GUI operations on it")},
+        {"files", QStringLiteral("Generated files (default 10000)"), "count", "10000"},
+        {"checkpoints", QStringLiteral("Generated checkpoints (default 50)"), "count", "50"},
+        {"churn", QStringLiteral("Share of the files changed per checkpoint (default 0.01)"), "ratio", "0.01"},
+        {"binary", QStringLiteral("Share of binary files (default 0.1)"), "ratio", "0.1"},
+        {"file-size", QStringLiteral("Average file size in bytes (default 4096)"), "bytes", "4096"},
+        {"layout", QStringLiteral("deep (8 directory levels) or flat (default deep)"), "layout", "deep"},
+        {"seed", QStringLiteral("Random seed (default 1)"), "number", "1"},
+        {"keep", QStringLiteral("Keep the generated temporary directory")},
+        {"json", QStringLiteral("Write the results as JSON to <file>, - for standard output"), "file"},
+        {{"v", "verbose"}, QStringLiteral("Log the git commands being run")},
+    });
+    parser.addPositionalArgument(QStringLiteral("<dir>"), QStringLiteral("Checkpoint repository to read"));
+    parser.process(app);
+
+    if (!parser.isSet("verbose")) {
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+    }
+    const int iterations = std::max(1, parser.value("iterations").toInt());
+    const bool generate = parser.isSet("generate");
+    SynthRepo::Options options;
+    options.files = std::max(1, parser.value("files").toInt());
+    options.checkpoints = std::max(2, parser.value("checkpoints").toInt());
+    options.churn = std::clamp(parser.value("churn").toDouble(), 0.0, 1.0);
+    options.binary = std::clamp(parser.value("binary").toDouble(), 0.0, 1.0);
+    options.fileSize = std::max(16, parser.value("file-size").toInt());
+    options.layout = parser.value("layout") == "flat" ? SynthRepo::Layout::Flat : SynthRepo::Layout::Deep;
+    options.seed = parser.value("seed").toUInt();
+
+    QTemporaryDir tempDir;
+    tempDir.setAutoRemove(!parser.isSet("keep"));
+    QString dir = parser.positionalArguments().value(0);
+    if (dir.isEmpty()) {
+        dir = generate ? tempDir.path() : QDir::currentPath();
+    }
+    dir = QDir(dir).absolutePath();
+
+    const bool jsonToStdout = parser.value("json") == "-";
+    QTextStream out(jsonToStdout ? stderr : stdout);
+    QList<Sample> samples;
+    if (generate) {
+        out << QString("Generating %1 files and %2 checkpoints in %3\n").arg(options.files).arg(options.checkpoints).arg(dir);
+        out.flush();
+        QElapsedTimer timer;
+        timer.start();
+        Sample sample;
+        sample.backend = QStringLiteral("git");
+        sample.query = QStringLiteral("generate");
+        sample.ok = SynthRepo::generate(dir, options);
+        sample.items = options.files;
+        sample.setTimes({timer.nsecsElapsed() / 1000});
+        samples.append(sample);
+        if (!sample.ok) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    samples += compareBackends(dir, iterations);
+    if (generate) {
+        // Git works on the current directory like the GUI does; this changes the repository, so it comes last
+        QDir::setCurrent(dir);
+        samples += runScenario(dir, options, iterations);
+    }
+    printTable(out, samples);
+
+    if (parser.isSet("json")) {
+        QJsonArray results;
+        for (const Sample &sample : std::as_const(samples)) {
+            results.append(sample.toJson());
+        }
+        QJsonObject report {{"git", gitVersion()}, {"dir", dir}, {"iterations", iterations}, {"results", results}};
+        if (generate) {
+            report.insert("repository", options.toJson());
+        }
+        const QByteArray json = QJsonDocument(report).toJson();
+        QFile file(parser.value("json"));
+        const bool opened = jsonToStdout ? file.open(stdout, QIODevice::WriteOnly) : file.open(QIODevice::WriteOnly);
+        if (!opened || file.write(json) != json.size()) {
+            qWarning() << "Can't write" << parser.value("json");
+            return EXIT_FAILURE;
+        }
+    }
+    // Failed queries are marked in the results, e.g. tree-diff on a repository with a single checkpoint
+    return EXIT_SUCCESS;
+}
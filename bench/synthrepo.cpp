@@ -0,0 +1,193 @@
+/**********************************************************************
+ *  synthrepo.cpp
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "synthrepo.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+constexpr int FilesPerDir = 32;
+constexpr int DeepLevels = 8;
+
+bool isBinary(const SynthRepo::Options &options, int index)
+{
+    // Spread evenly instead of drawing, so the share doesn't depend on the seed
+    return options.binary > 0 && static_cast<int>(index * options.binary) != static_cast<int>((index + 1) * options.binary);
+}
+
+QByteArray textLine(QRandomGenerator &random)
+{
+    static const std::array<const char *, 16> words {"alpha", "bravo", "charlie", "delta", "echo",  "foxtrot",
+                                                     "golf",  "hotel", "india",   "juliet", "kilo", "lima",
+                                                     "mike",  "oscar", "papa",    "quebec"};
+    QByteArray line;
+    for (int i = 0; i < 8; ++i) {
+        line += words.at(random.bounded(static_cast<int>(words.size())));
+        line += i < 7 ? ' ' : '\n';
+    }
+    return line;
+}
+
+QByteArray content(const SynthRepo::Options &options, int index, QRandomGenerator &random)
+{
+    // Sizes between half and one and a half times the average
+    const int size = options.fileSize / 2 + random.bounded(std::max(1, options.fileSize));
+    QByteArray data;
+    data.reserve(size + 64);
+    if (isBinary(options, index)) {
+        data.fill('\0', size);
+        random.fillRange(reinterpret_cast<quint32 *>(data.data()), size / 4);
+        data[0] = '\0'; // git looks for a NUL in the first 8000 bytes
+        return data;
+    }
+    while (data.size() < size) {
+        data += textLine(random);
+    }
+    return data;
+}
+
+bool writeFile(const QString &fileName, const QByteArray &data)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(data) != data.size()) {
+        qWarning() << "Can't write" << fileName << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool git(const QString &dir, const QStringList &args)
+{
+    QProcess proc;
+    proc.setWorkingDirectory(dir);
+    proc.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    proc.setStandardOutputFile(QProcess::nullDevice());
+    proc.start("git", args);
+    if (!proc.waitForFinished(-1) || proc.exitStatus() != QProcess::NormalExit || proc.exitCode() != 0) {
+        qWarning() << "git" << args << "failed in" << dir;
+        return false;
+    }
+    return true;
+}
+
+bool checkpoint(const QString &dir, int number)
+{
+    return git(dir, {"add", "-A"}) && git(dir, {"commit", "-q", "--no-verify", "-m", QString("Checkpoint %1").arg(number)});
+}
+} // namespace
+
+QJsonObject SynthRepo::Options::toJson() const
+{
+    return {{"files", files},
+            {"checkpoints", checkpoints},
+            {"churn", churn},
+            {"binary", binary},
+            {"file_size", fileSize},
+            {"layout", layout == Layout::Flat ? "flat" : "deep"},
+            {"seed", static_cast<qint64>(seed)}};
+}
+
+QString SynthRepo::path(const Options &options, int index)
+{
+    const QString name = QString("f%1.%2").arg(index).arg(isBinary(options, index) ? "bin" : "txt");
+    if (options.layout == Layout::Flat) {
+        return name;
+    }
+    // Base 4 digits of the directory number, always DeepLevels directories down
+    QString path;
+    int dir = index / FilesPerDir;
+    for (int level = 0; level < DeepLevels; ++level, dir /= 4) {
+        path += QString("d%1/").arg(dir % 4);
+    }
+    return path + name;
+}
+
+bool SynthRepo::generate(const QString &dir, const Options &options)
+{
+    if (!QDir().mkpath(dir) || !QDir(dir).isEmpty()) {
+        qWarning() << dir << "must be an empty directory";
+        return false;
+    }
+    QRandomGenerator random(options.seed);
+    QString lastDir;
+    for (int i = 0; i < options.files; ++i) {
+        const QString fileName = dir + '/' + path(options, i);
+        const QString fileDir = fileName.section('/', 0, -2);
+        if (fileDir != lastDir && !QDir().mkpath(fileDir)) {
+            return false;
+        }
+        lastDir = fileDir;
+        if (!writeFile(fileName, content(options, i, random))) {
+            return false;
+        }
+    }
+    // Local identity, so neither the user's configuration nor a missing one changes the result
+    if (!git(dir, {"init", "-q"}) || !git(dir, {"config", "user.name", "restore-bench"})
+        || !git(dir, {"config", "user.email", "restore-bench@localhost"})
+        || !git(dir, {"config", "commit.gpgsign", "false"}) || !checkpoint(dir, 1)) {
+        return false;
+    }
+    for (int number = 2; number <= options.checkpoints; ++number) {
+        modify(dir, options, options.churn, random);
+        if (!checkpoint(dir, number)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QStringList SynthRepo::modify(const QString &dir, const Options &options, double ratio, QRandomGenerator &random)
+{
+    const int count = std::clamp(static_cast<int>(options.files * ratio), options.files > 0 ? 1 : 0, options.files);
+    QStringList changed;
+    changed.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const int index = random.bounded(options.files);
+        const QString fileName = dir + '/' + path(options, index);
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QByteArray data = file.readAll();
+        file.close();
+        if (isBinary(options, index)) {
+            for (int n = 0; n < 16 && data.size() > 1; ++n) {
+                data[1 + random.bounded(static_cast<int>(data.size() - 1))] = static_cast<char>(random.bounded(256));
+            }
+        } else {
+            QList<QByteArray> lines = data.split('\n');
+            lines[random.bounded(static_cast<int>(lines.size()))] = textLine(random).chopped(1);
+            data = lines.join('\n');
+        }
+        if (writeFile(fileName, data)) {
+            changed.append(path(options, index));
+        }
+    }
+    changed.removeDuplicates();
+    return changed;
+}
@@ -0,0 +1,57 @@
+/**********************************************************************
+ *  synthrepo.h
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef SYNTHREPO_H
+#define SYNTHREPO_H
+
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QStringList>
+
+// Reproducible checkpoint repositories for restore-bench: a directory of generated text and binary files
+// with a history in which a fixed share of the files changes between two checkpoints.
+namespace SynthRepo
+{
+enum class Layout { Flat, Deep };
+
+struct Options {
+    int files {10000};
+    int checkpoints {50};
+    double churn {0.01};  // share of the files modified per checkpoint
+    double binary {0.1};  // share of the files that are binary
+    int fileSize {4096};  // average size in bytes
+    Layout layout {Layout::Deep};
+    quint32 seed {1};
+
+    [[nodiscard]] QJsonObject toJson() const;
+};
+
+// Directory and file name of file number index, "d2/d0/.../f123.txt" in the deep layout
+[[nodiscard]] QString path(const Options &options, int index);
+
+// Create the files in dir (empty or missing) and commit options.checkpoints checkpoints of them
+[[nodiscard]] bool generate(const QString &dir, const Options &options);
+
+// Change ratio of the files in place: one line of a text file, a few bytes of a binary one. Returns their paths.
+QStringList modify(const QString &dir, const Options &options, double ratio, QRandomGenerator &random);
+} // namespace SynthRepo
+
+#endif // SYNTHREPO_H
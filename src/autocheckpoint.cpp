@@ -0,0 +1,335 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "autocheckpoint.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <csignal>
+#include <cstring>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include "git.h"
+
+namespace
+{
+constexpr uint32_t WatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB
+                               | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+QByteArray pathspecInput(const QStringList &paths)
+{
+    QByteArray input;
+    for (const QString &path : paths) {
+        input.append(path.toUtf8());
+        input.append('\0');
+    }
+    return input;
+}
+} // namespace
+
+AutoCheckpoint::AutoCheckpoint(int quietSeconds, QObject *parent)
+    : QObject(parent),
+      quietMsecs(quietSeconds * 1000),
+      git(new Git(this))
+{
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        qWarning() << "inotify unavailable:" << strerror(errno);
+    } else {
+        auto *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &AutoCheckpoint::readEvents);
+    }
+
+    // SIGTERM/SIGINT commit what is pending before leaving. Blocked for this process only, JobQueue and Cmd
+    // start their commands with an empty mask.
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd >= 0) {
+        auto *notifier = new QSocketNotifier(signalFd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this] {
+            signalfd_siginfo info {};
+            while (read(signalFd, &info, sizeof(info)) == sizeof(info)) { }
+            flushAndQuit();
+        });
+    }
+}
+
+AutoCheckpoint::~AutoCheckpoint()
+{
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (signalFd >= 0) {
+        close(signalFd);
+    }
+}
+
+// Changes made while nothing was watching are picked up by one full checkpoint at start
+bool AutoCheckpoint::watch(const QString &dir)
+{
+    const QString path = QDir(dir).absolutePath();
+    if (fd < 0 || !QFileInfo(path).isDir()) {
+        qWarning() << "Can't watch" << dir;
+        return false;
+    }
+    if (!git->initializeDirectory(path)) {
+        qWarning() << "Can't create a repository in" << path;
+        return false;
+    }
+    Root root;
+    root.path = path;
+    root.fullScan = true;
+    root.elevated = Git::needElevation(path);
+    root.timer = new QTimer(this);
+    root.timer->setSingleShot(true);
+    const int index = static_cast<int>(roots.size());
+    connect(root.timer, &QTimer::timeout, this, [this, index] { checkpoint(index); });
+    roots.append(root);
+    addWatches(index, {});
+    qInfo().noquote() << "Watching" << path << "with" << watches.size() << "directory watches";
+    checkpoint(index);
+    return true;
+}
+
+void AutoCheckpoint::flushAndQuit()
+{
+    quitting = true;
+    for (int i = 0; i < roots.size(); ++i) {
+        if (!roots.at(i).dirty.isEmpty() || roots.at(i).fullScan) {
+            checkpoint(i);
+        }
+    }
+    if (pendingCommits == 0) {
+        QCoreApplication::quit();
+    }
+}
+
+// Watch dir and everything below it except .git and what the repository ignores (node_modules, build trees),
+// one level at a time so each level is checked with one check-ignore; a directory that appears later is added
+// from its event
+void AutoCheckpoint::addWatches(int root, const QString &dir)
+{
+    QStringList level = dir.isEmpty() ? QStringList {dir} : unignored(root, {dir});
+    while (!level.isEmpty()) {
+        QStringList next;
+        for (const QString &relative : std::as_const(level)) {
+            const QString absolute = relative.isEmpty() ? roots.at(root).path : roots.at(root).path + '/' + relative;
+            const int wd = inotify_add_watch(fd, QFile::encodeName(absolute).constData(), WatchMask);
+            if (wd < 0) {
+                if (errno == ENOSPC) {
+                    qWarning() << "Out of inotify watches (fs.inotify.max_user_watches), checkpoints of"
+                               << roots.at(root).path << "fall back to full scans";
+                    roots[root].fullyWatched = false;
+                    return;
+                }
+                continue;
+            }
+            watches.insert(wd, {root, relative});
+            const QStringList subdirs
+                = QDir(absolute).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks);
+            for (const QString &name : subdirs) {
+                if (relative.isEmpty() && name == QLatin1String(".git")) {
+                    continue;
+                }
+                next.append(relative.isEmpty() ? name : relative + '/' + name);
+            }
+        }
+        level = unignored(root, next);
+    }
+}
+
+// paths (relative to the root) without the ones the repository ignores; all of them if git can't tell
+QStringList AutoCheckpoint::unignored(int root, const QStringList &paths) const
+{
+    if (paths.isEmpty()) {
+        return {};
+    }
+    QProcess proc;
+    proc.setWorkingDirectory(roots.at(root).path);
+    proc.setChildProcessModifier([] {
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+    });
+    proc.start("git", {"--literal-pathspecs", "check-ignore", "--stdin", "-z"});
+    proc.write(pathspecInput(paths));
+    proc.closeWriteChannel();
+    // Exit code 1 is "nothing ignored"
+    if (!proc.waitForFinished(-1) || proc.exitStatus() != QProcess::NormalExit || proc.exitCode() != 0) {
+        return paths;
+    }
+    QSet<QString> skip;
+    for (const QByteArray &path : proc.readAllStandardOutput().split('\0')) {
+        skip.insert(QString::fromUtf8(path));
+    }
+    QStringList kept;
+    for (const QString &path : paths) {
+        if (!skip.contains(path)) {
+            kept.append(path);
+        }
+    }
+    return kept;
+}
+
+void AutoCheckpoint::readEvents()
+{
+    alignas(inotify_event) char buffer[64 * 1024];
+    ssize_t length = 0;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t offset = 0; offset < length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                for (int i = 0; i < roots.size(); ++i) {
+                    roots[i].fullScan = true;
+                    markDirty(i, {});
+                }
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watches.remove(event->wd);
+                continue;
+            }
+            const auto it = watches.constFind(event->wd);
+            if (it == watches.constEnd() || event->len == 0) {
+                continue;
+            }
+            const Watch watch = it.value();
+            const QString name = QFile::decodeName(event->name);
+            if (watch.dir.isEmpty() && name == QLatin1String(".git")) {
+                continue;
+            }
+            const QString path = watch.dir.isEmpty() ? name : watch.dir + '/' + name;
+            if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                addWatches(watch.root, path);
+            }
+            markDirty(watch.root, path);
+        }
+    }
+}
+
+void AutoCheckpoint::markDirty(int root, const QString &path)
+{
+    Root &entry = roots[root];
+    if (entry.dirty.isEmpty() && !entry.timer->isActive()) {
+        entry.firstChange.start();
+    }
+    if (!path.isEmpty()) {
+        entry.dirty.insert(path);
+    }
+    // Quiet period restarts with every change, but a tree that never settles still gets checkpoints
+    if (entry.firstChange.elapsed() < 10LL * quietMsecs) {
+        entry.timer->start(quietMsecs);
+    } else if (!entry.timer->isActive()) {
+        entry.timer->start(0);
+    }
+}
+
+void AutoCheckpoint::checkpoint(int root)
+{
+    Root &entry = roots[root];
+    // Elevated commands run one at a time in a nested event loop, another tree's turn comes after it
+    if (entry.elevated && elevatedBusy) {
+        entry.timer->start(quietMsecs);
+        return;
+    }
+    entry.timer->stop();
+    QList<JobCommand> commands;
+    if (entry.fullScan || !entry.fullyWatched) {
+        commands.append({"git", {"add", "-A", "."}, {}});
+    } else {
+        QStringList present;
+        QStringList gone;
+        for (const QString &path : std::as_const(entry.dirty)) {
+            const QFileInfo info(entry.path + '/' + path);
+            (info.exists() || info.isSymLink() ? present : gone).append(path);
+        }
+        if (!gone.isEmpty()) {
+            commands.append({"git",
+                             {"rm", "-r", "-q", "--cached", "--ignore-unmatch", "--pathspec-from-file=-",
+                              "--pathspec-file-nul"},
+                             pathspecInput(gone)});
+        }
+        // Ignored paths make "git add" fail, their changes are not checkpointed anyway
+        present = unignored(root, present);
+        if (!present.isEmpty()) {
+            commands.append(
+                {"git", {"add", "-A", "--pathspec-from-file=-", "--pathspec-file-nul"}, pathspecInput(present)});
+        }
+    }
+    const qsizetype changed = entry.dirty.size();
+    entry.dirty.clear();
+    entry.fullScan = false;
+    if (commands.isEmpty()) {
+        return;
+    }
+    // "nothing to commit" exits with 1, that is not an error here
+    commands.append({"git", {"commit", "-q", "-m", "Automatic checkpoint"}, {}});
+
+    ++pendingCommits;
+    const QString path = entry.path;
+    if (entry.elevated) {
+        // Git::runIn adds --literal-pathspecs itself, and its output goes to the log
+        elevatedBusy = true;
+        QList<JobResult> results;
+        for (const JobCommand &command : std::as_const(commands)) {
+            results.append({git->runIn(path, command.args, command.input) ? 0 : 1, {}, {}});
+        }
+        elevatedBusy = false;
+        committed(path, changed, results);
+        return;
+    }
+    for (JobCommand &command : commands) {
+        command.args.prepend(QStringLiteral("--literal-pathspecs"));
+    }
+    jobs.enqueue(path, QString(), JobQueue::Priority::Normal, commands, this,
+                 [this, path, changed](const QList<JobResult> &results) { committed(path, changed, results); });
+}
+
+void AutoCheckpoint::committed(const QString &path, qsizetype changed, const QList<JobResult> &results)
+{
+    --pendingCommits;
+    for (qsizetype i = 0; i + 1 < results.size(); ++i) {
+        if (!results.at(i).ok()) {
+            qWarning().noquote() << path << QString::fromUtf8(results.at(i).err).trimmed();
+        }
+    }
+    if (results.constLast().ok()) {
+        qInfo().noquote() << "Checkpoint of" << path << "with" << changed << "changed paths";
+    }
+    if (quitting && pendingCommits == 0) {
+        QCoreApplication::quit();
+    }
+}
@@ -0,0 +1,86 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef AUTOCHECKPOINT_H
+#define AUTOCHECKPOINT_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+#include "jobqueue.h"
+
+class Git;
+class QSocketNotifier;
+class QTimer;
+
+// Headless "restore-gui --watch": inotify watches on every directory of the watched trees that the repository
+// doesn't ignore collect the paths that changed, and once a tree has been quiet for a while (or has been busy
+// for ten quiet periods) only those paths are staged and committed. Nothing runs while nothing changes; a queue overflow or
+// running out of watches falls back to "git add -A ." for that tree. A directory that isn't in a repository
+// yet gets one, and trees the user can't write to are committed through Git's elevation path.
+class AutoCheckpoint : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AutoCheckpoint(int quietSeconds, QObject *parent = nullptr);
+    ~AutoCheckpoint() override;
+
+    bool watch(const QString &dir);
+    void flushAndQuit();
+
+private:
+    struct Root {
+        QString path;
+        QSet<QString> dirty;
+        bool fullScan {false};
+        bool fullyWatched {true};
+        bool elevated {false};
+        QTimer *timer {nullptr};
+        QElapsedTimer firstChange;
+    };
+    struct Watch {
+        int root {0};
+        QString dir; // relative to the root, empty for the root itself
+    };
+
+    int fd {-1};
+    int signalFd {-1};
+    int quietMsecs;
+    int pendingCommits {0};
+    bool quitting {false};
+    bool elevatedBusy {false};
+    Git *git;
+    QList<Root> roots;
+    QHash<int, Watch> watches;
+    JobQueue jobs;
+
+    void addWatches(int root, const QString &dir);
+    [[nodiscard]] QStringList unignored(int root, const QStringList &paths) const;
+    void checkpoint(int root);
+    void committed(const QString &path, qsizetype changed, const QList<JobResult> &results);
+    void markDirty(int root, const QString &path);
+    void readEvents();
+};
+
+#endif // AUTOCHECKPOINT_H
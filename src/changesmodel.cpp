@@ -0,0 +1,140 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "changesmodel.h"
+
+#include <limits>
+
+ChangesModel::ChangesModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+// The placeholder row only appears once a (possibly empty) change list was set
+int ChangesModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    if (changes.isEmpty()) {
+        return loaded && !placeholder.isEmpty() ? 1 : 0;
+    }
+    return static_cast<int>(std::min<qsizetype>(changes.size(), std::numeric_limits<int>::max()));
+}
+
+QVariant ChangesModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return {};
+    }
+    const int row = index.row();
+    if (isPlaceholder(row)) {
+        return role == Qt::DisplayRole ? QVariant(placeholder) : QVariant();
+    }
+    switch (role) {
+    case Qt::DisplayRole:
+        return ChangeList::code(changes.status(row)).leftJustified(3) + path(row);
+    case Qt::CheckStateRole:
+        return checked[row] ? Qt::Checked : Qt::Unchecked;
+    case PathRole:
+        return path(row);
+    case StatusRole:
+        return ChangeList::code(changes.status(row));
+    default:
+        return {};
+    }
+}
+
+Qt::ItemFlags ChangesModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    if (isPlaceholder(index.row())) {
+        return Qt::ItemIsEnabled;
+    }
+    return Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
+}
+
+bool ChangesModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::CheckStateRole || !index.isValid() || isPlaceholder(index.row())) {
+        return false;
+    }
+    const int row = index.row();
+    const bool check = value.toInt() == Qt::Checked;
+    if (checked[row] == check) {
+        return true;
+    }
+    checked[row] = check;
+    selected += check ? 1 : -1;
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    emit selectedCountChanged(selected);
+    return true;
+}
+
+QStringList ChangesModel::selectedPaths() const
+{
+    QStringList list;
+    list.reserve(selected);
+    for (std::size_t row = 0; row < checked.size() && list.size() < selected; ++row) {
+        if (checked[row]) {
+            list.append(path(static_cast<int>(row)));
+        }
+    }
+    return list;
+}
+
+QString ChangesModel::path(int row) const
+{
+    return changes.path(row);
+}
+
+void ChangesModel::clear()
+{
+    beginResetModel();
+    changes = {};
+    checked.clear();
+    loaded = false;
+    const bool hadSelection = selected != 0;
+    selected = 0;
+    endResetModel();
+    if (hadSelection) {
+        emit selectedCountChanged(selected);
+    }
+}
+
+void ChangesModel::setChanges(const ChangeList &list)
+{
+    clear();
+    beginResetModel();
+    changes = list;
+    checked.assign(static_cast<std::size_t>(changes.size()), false);
+    loaded = true;
+    endResetModel();
+}
+
+void ChangesModel::setPlaceholder(const QString &text)
+{
+    beginResetModel();
+    placeholder = text;
+    endResetModel();
+}
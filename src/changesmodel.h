@@ -0,0 +1,69 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef CHANGESMODEL_H
+#define CHANGESMODEL_H
+
+#include <QAbstractListModel>
+#include <QStringList>
+
+#include <vector>
+
+#include "statusengine.h"
+
+// Checkable list of changes for a QListView. Rows are the ChangeList as git's output was parsed into it plus
+// a check state each, paths are decoded when a row is painted, and the number of checked rows is kept up to
+// date on every toggle.
+class ChangesModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Role { PathRole = Qt::UserRole, StatusRole };
+
+    explicit ChangesModel(QObject *parent = nullptr);
+
+    [[nodiscard]] int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    [[nodiscard]] QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    [[nodiscard]] Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+
+    [[nodiscard]] bool hasChanges() const { return !changes.isEmpty(); }
+    [[nodiscard]] qsizetype selectedCount() const { return selected; }
+    [[nodiscard]] QStringList selectedPaths() const;
+    [[nodiscard]] QString path(int row) const;
+    void clear();
+    void setChanges(const ChangeList &list);
+    void setPlaceholder(const QString &text);
+
+signals:
+    void selectedCountChanged(qsizetype count);
+
+private:
+    ChangeList changes;
+    std::vector<bool> checked;
+    QString placeholder;
+    qsizetype selected {0};
+    bool loaded {false};
+
+    [[nodiscard]] bool isPlaceholder(int row) const { return changes.isEmpty() && row == 0; }
+};
+
+#endif // CHANGESMODEL_H
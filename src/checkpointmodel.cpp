@@ -0,0 +1,171 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "checkpointmodel.h"
+
+#include <algorithm>
+
+#include "git.h"
+
+CheckpointModel::CheckpointModel(Git *git, QObject *parent)
+    : QAbstractListModel(parent),
+      git(git)
+{
+}
+
+int CheckpointModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return isEmpty() ? 1 : rows;
+}
+
+QVariant CheckpointModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return {};
+    }
+    if (isEmpty()) {
+        return role == Qt::DisplayRole ? QVariant(tr("No checkpoints")) : QVariant();
+    }
+    if (role != Qt::DisplayRole && role != CommitRole) {
+        return {};
+    }
+    const int page = index.row() / PageSize;
+    auto *self = const_cast<CheckpointModel *>(this);
+    const auto it = pages.constFind(page);
+    if (it == pages.constEnd()) {
+        // Not from inside data(): a cached page would arrive synchronously and change the model under the view
+        if (!requestedPages.contains(page)) {
+            self->requestedPages.insert(page);
+            QMetaObject::invokeMethod(
+                self,
+                [self, page, gen = generation] {
+                    self->requestedPages.remove(page);
+                    if (gen == self->generation) {
+                        self->requestPage(page);
+                    }
+                },
+                Qt::QueuedConnection);
+        }
+        return role == Qt::DisplayRole ? QVariant(tr("Loading...")) : QVariant();
+    }
+    self->touchPage(page);
+    const qsizetype offset = index.row() % PageSize;
+    if (offset >= it->size()) {
+        return {}; // the history shrank, pageLoaded reloads
+    }
+    const Checkpoint &checkpoint = it->at(offset);
+    return role == Qt::DisplayRole ? checkpoint.label : checkpoint.commit;
+}
+
+bool CheckpointModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && loaded && !atEnd && !requestedPages.contains(rows / PageSize);
+}
+
+void CheckpointModel::fetchMore(const QModelIndex &parent)
+{
+    if (canFetchMore(parent)) {
+        requestPage(rows / PageSize);
+    }
+}
+
+void CheckpointModel::reload()
+{
+    beginResetModel();
+    pages.clear();
+    recentPages.clear();
+    requestedPages.clear();
+    rows = 0;
+    atEnd = false;
+    loaded = false;
+    ++generation;
+    endResetModel();
+    requestPage(0);
+}
+
+void CheckpointModel::requestPage(int page)
+{
+    if (requestedPages.contains(page)) {
+        return;
+    }
+    requestedPages.insert(page);
+    git->listCommitsAsync(page * PageSize, PageSize, this,
+                          [this, page, gen = generation](bool /*ok*/, const QStringList &log) {
+                              if (gen == generation) {
+                                  pageLoaded(page, log);
+                              }
+                          });
+}
+
+// A failed git log (no repository, no commit yet) reads as an empty history
+void CheckpointModel::pageLoaded(int page, const QStringList &log)
+{
+    requestedPages.remove(page);
+    QList<Checkpoint> entries;
+    entries.reserve(log.size());
+    for (const QString &line : log) {
+        const qsizetype separator = line.indexOf('|');
+        if (separator > 0) {
+            entries.append({line.left(separator), line.mid(separator + 1)});
+        }
+    }
+
+    const int first = page * PageSize;
+    const int count = static_cast<int>(entries.size());
+    pages.insert(page, entries);
+    touchPage(page);
+    while (recentPages.size() > MaxPages) {
+        pages.remove(recentPages.takeFirst());
+    }
+
+    if (page == 0 && !loaded) {
+        beginInsertRows(QModelIndex(), 0, std::max(count, 1) - 1);
+        loaded = true;
+        rows = count;
+        atEnd = count < PageSize;
+        endInsertRows();
+        emit firstPageLoaded();
+    } else if (first >= rows) {
+        if (count > 0) {
+            beginInsertRows(QModelIndex(), first, first + count - 1);
+            rows += count;
+            endInsertRows();
+        }
+        atEnd = count < PageSize;
+    } else if (count < std::min(PageSize, rows - first)) {
+        // An evicted page came back short, the history shrank (retention, reset) since the rows were counted
+        reload();
+    } else {
+        // A page that was evicted and read again
+        emit dataChanged(index(first), index(std::min(first + count, rows) - 1));
+    }
+}
+
+void CheckpointModel::touchPage(int page)
+{
+    if (recentPages.isEmpty() || recentPages.constLast() != page) {
+        recentPages.removeOne(page);
+        recentPages.append(page);
+    }
+}
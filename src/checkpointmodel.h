@@ -0,0 +1,77 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef CHECKPOINTMODEL_H
+#define CHECKPOINTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QSet>
+
+class Git;
+
+// Checkpoint history of the current directory, newest first, read from git log one page at a time.
+// The view asks for the next page when it scrolls to the end (canFetchMore/fetchMore) and only the most
+// recently used pages stay in memory; an evicted page is read again when its rows are painted.
+class CheckpointModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Role { CommitRole = Qt::UserRole };
+    static constexpr int PageSize = 100;
+    static constexpr int MaxPages = 10;
+
+    explicit CheckpointModel(Git *git, QObject *parent = nullptr);
+
+    [[nodiscard]] int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    [[nodiscard]] QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    [[nodiscard]] bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    [[nodiscard]] bool isEmpty() const { return loaded && rows == 0; }
+    void reload();
+
+signals:
+    // The first page arrived, row 0 is the newest checkpoint or the "No checkpoints" placeholder
+    void firstPageLoaded();
+
+private:
+    struct Checkpoint {
+        QString commit;
+        QString label;
+    };
+
+    Git *git;
+    QHash<int, QList<Checkpoint>> pages;
+    QList<int> recentPages; // most recently used last
+    QSet<int> requestedPages;
+    int rows {0};
+    quint64 generation {0};
+    bool atEnd {false};
+    bool loaded {false};
+
+    void pageLoaded(int page, const QStringList &log);
+    void requestPage(int page);
+    void touchPage(int page);
+};
+
+#endif // CHECKPOINTMODEL_H
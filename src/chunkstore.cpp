@@ -0,0 +1,339 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "chunkstore.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QProcess>
+#include <QSaveFile>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <vector>
+
+namespace
+{
+constexpr qsizetype MinChunk = 256 * 1024;
+constexpr qsizetype MaxChunk = 4 * 1024 * 1024;
+// Top 20 bits of the gear hash, which depend on the last 64 bytes: about 1 MiB past the minimum on average
+constexpr quint64 BoundaryMask = ((quint64(1) << 20) - 1) << 44;
+constexpr qsizetype WindowSize = 64 * 1024 * 1024;
+const QByteArray Magic = QByteArrayLiteral("restore-gui chunks 1\n");
+
+struct Chunk {
+    QByteArray hash; // hex
+    qsizetype length {0};
+};
+
+// Fixed for good, the chunk boundaries of everything already stored depend on it
+const std::array<quint64, 256> &gearTable()
+{
+    static const std::array<quint64, 256> table = [] {
+        std::array<quint64, 256> values {};
+        quint64 state = 0;
+        for (quint64 &value : values) { // splitmix64
+            state += 0x9e3779b97f4a7c15ULL;
+            quint64 z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            value = z ^ (z >> 31);
+        }
+        return values;
+    }();
+    return table;
+}
+
+// Length of the chunk starting at data, -1 if size ends before a boundary and more input follows
+qsizetype cutPoint(const char *data, qsizetype size, bool last)
+{
+    const qsizetype end = std::min(size, MaxChunk);
+    if (size > MinChunk) {
+        const auto &gear = gearTable();
+        quint64 hash = 0;
+        for (qsizetype i = MinChunk; i < end; ++i) {
+            hash = (hash << 1) + gear[static_cast<uchar>(data[i])];
+            if ((hash & BoundaryMask) == 0) {
+                return i + 1;
+            }
+        }
+    }
+    if (end == MaxChunk) {
+        return MaxChunk;
+    }
+    return last ? size : -1;
+}
+
+QString chunkPath(const QString &storeDir, const QByteArray &hash)
+{
+    const QString name = QString::fromLatin1(hash);
+    return storeDir + '/' + name.left(2) + '/' + name.mid(2);
+}
+
+// Chunks are immutable and named by their hash, an existing file is the same chunk
+bool store(const QString &storeDir, const QByteArray &hash, const QByteArray &data)
+{
+    const QString path = chunkPath(storeDir, hash);
+    if (QFileInfo::exists(path)) {
+        return true;
+    }
+    QDir().mkpath(QFileInfo(path).path());
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
+
+bool writeAll(QIODevice &out, const QByteArray &data)
+{
+    return out.write(data) == data.size();
+}
+
+// Paths in the repository's attributes file that use the filter
+QStringList filteredPaths(const QString &gitDir)
+{
+    QFile file(gitDir + "/info/attributes");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    QStringList paths;
+    const QByteArray suffix = QByteArray(" filter=") + ChunkStore::FilterName + " -diff";
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (!line.endsWith(suffix) || !line.startsWith("\"/")) {
+            continue;
+        }
+        // Undo the C quoting, then the glob escaping
+        QByteArray pattern = line.mid(2, line.size() - suffix.size() - 3);
+        QByteArray path;
+        for (qsizetype i = 0; i < pattern.size(); ++i) {
+            if (pattern.at(i) == '\\' && i + 1 < pattern.size()) {
+                ++i;
+            }
+            path += pattern.at(i);
+        }
+        paths.append(QString::fromUtf8(path));
+    }
+    return paths;
+}
+
+bool run(const QString &dir, const QStringList &args, QByteArray *output, const QByteArray &input = {})
+{
+    QProcess proc;
+    proc.setWorkingDirectory(dir);
+    proc.start("git", args);
+    proc.write(input);
+    proc.closeWriteChannel();
+    if (!proc.waitForFinished(-1) || proc.exitStatus() != QProcess::NormalExit || proc.exitCode() != 0) {
+        return false;
+    }
+    *output = proc.readAllStandardOutput();
+    return true;
+}
+} // namespace
+
+QString ChunkStore::storeDir(const QString &gitDir)
+{
+    return gitDir + "/restore-gui/chunks";
+}
+
+bool ChunkStore::isPointer(const QByteArray &data)
+{
+    return data.startsWith(Magic);
+}
+
+bool ChunkStore::clean(QIODevice &in, QIODevice &out, const QString &storeDir)
+{
+    QByteArray buffer = in.read(Magic.size());
+    if (isPointer(buffer)) {
+        return writeAll(out, buffer) && writeAll(out, in.readAll());
+    }
+    std::vector<Chunk> chunks;
+    qint64 total = 0;
+    bool eof = false;
+    QThreadPool pool;
+    while (true) {
+        while (!eof && buffer.size() < WindowSize) {
+            const QByteArray data = in.read(WindowSize - buffer.size());
+            eof = data.isEmpty();
+            buffer += data;
+        }
+        // Boundaries are found in one pass, the tail without one waits for the next window
+        QList<QPair<qsizetype, qsizetype>> spans;
+        qsizetype pos = 0;
+        while (pos < buffer.size()) {
+            const qsizetype length = cutPoint(buffer.constData() + pos, buffer.size() - pos, eof);
+            if (length < 0) {
+                break;
+            }
+            spans.append({pos, length});
+            pos += length;
+        }
+        const size_t first = chunks.size();
+        chunks.resize(first + spans.size());
+        std::atomic<bool> failed {false};
+        for (qsizetype i = 0; i < spans.size(); ++i) {
+            pool.start([&, i] {
+                const auto [offset, length] = spans.at(i);
+                const QByteArray data = QByteArray::fromRawData(buffer.constData() + offset, length);
+                const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+                if (!store(storeDir, hash, data)) {
+                    failed = true;
+                }
+                chunks[first + i] = {hash, length};
+            });
+        }
+        pool.waitForDone();
+        if (failed) {
+            qWarning() << "Can't write chunks to" << storeDir;
+            return false;
+        }
+        total += pos;
+        buffer.remove(0, pos);
+        if (eof && buffer.isEmpty()) {
+            break;
+        }
+    }
+
+    QByteArray pointer = Magic + "size " + QByteArray::number(total) + '\n';
+    for (const Chunk &chunk : chunks) {
+        pointer += chunk.hash + ' ' + QByteArray::number(chunk.length) + '\n';
+    }
+    return writeAll(out, pointer);
+}
+
+bool ChunkStore::smudge(QIODevice &in, QIODevice &out, const QString &storeDir)
+{
+    const QByteArray pointer = in.readAll();
+    if (!isPointer(pointer)) {
+        return writeAll(out, pointer);
+    }
+    for (const QByteArray &line : pointer.mid(Magic.size()).split('\n')) {
+        const QList<QByteArray> fields = line.split(' ');
+        if (fields.size() != 2 || fields.at(0) == "size") {
+            continue;
+        }
+        QFile file(chunkPath(storeDir, fields.at(0)));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Missing chunk" << file.fileName();
+            return false;
+        }
+        // Nothing damaged is written back, the pointer's hash is the chunk's name
+        const QByteArray data = file.readAll();
+        if (data.size() != fields.at(1).toLongLong()
+            || QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex() != fields.at(0)) {
+            qWarning() << "Damaged chunk" << file.fileName();
+            return false;
+        }
+        if (!writeAll(out, data)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QSet<QByteArray> ChunkStore::chunks(const QByteArray &pointer)
+{
+    QSet<QByteArray> hashes;
+    if (!isPointer(pointer)) {
+        return hashes;
+    }
+    for (const QByteArray &line : pointer.mid(Magic.size()).split('\n')) {
+        const QList<QByteArray> fields = line.split(' ');
+        if (fields.size() == 2 && fields.at(0) != "size") {
+            hashes.insert(fields.at(0));
+        }
+    }
+    return hashes;
+}
+
+QString ChunkStore::attributeLine(const QString &path)
+{
+    QString pattern;
+    for (const QChar c : path) {
+        if (c == '\\' || c == '*' || c == '?' || c == '[') {
+            pattern += '\\';
+        }
+        pattern += c;
+    }
+    pattern.replace('\\', QStringLiteral("\\\\")).replace('"', QStringLiteral("\\\""));
+    return QString("\"/%1\" filter=%2 -diff").arg(pattern, QLatin1String(FilterName));
+}
+
+// Chunks are referenced by the pointer blobs of the chunked paths anywhere in the history, reflogs included
+qint64 ChunkStore::collectGarbage(const QString &dir, const QString &gitDir)
+{
+    const QString store = storeDir(gitDir);
+    const QStringList paths = filteredPaths(gitDir);
+    if (!QFileInfo::exists(store) || paths.isEmpty()) {
+        return 0;
+    }
+    const QSet<QString> chunked(paths.cbegin(), paths.cend());
+    // Chunks are only deleted against a referenced set that was fully built, anything else keeps them all
+    QByteArray objects;
+    if (!run(dir, {"rev-list", "--all", "--reflog", "--objects"}, &objects) || objects.isEmpty()) {
+        return 0;
+    }
+    QByteArray blobs;
+    for (const QByteArray &line : objects.split('\n')) {
+        const qsizetype space = line.indexOf(' ');
+        if (space > 0 && chunked.contains(QString::fromUtf8(line.mid(space + 1)))) {
+            blobs += line.left(space) + '\n';
+        }
+    }
+    QByteArray contents;
+    if (blobs.isEmpty() || !run(dir, {"cat-file", "--batch"}, &contents, blobs)) {
+        return 0;
+    }
+    QSet<QByteArray> referenced;
+    // "<oid> <type> <size>\n<content>\n" per object
+    for (qsizetype pos = 0; pos < contents.size();) {
+        const qsizetype headerEnd = contents.indexOf('\n', pos);
+        const QList<QByteArray> header = contents.mid(pos, headerEnd - pos).split(' ');
+        if (headerEnd < 0 || header.size() != 3 || headerEnd + 1 + header.at(2).toLongLong() >= contents.size()) {
+            return 0; // missing object or cut short
+        }
+        const qsizetype size = header.at(2).toLongLong();
+        referenced.unite(chunks(contents.mid(headerEnd + 1, size)));
+        pos = headerEnd + 1 + size + 1;
+    }
+    if (referenced.isEmpty()) {
+        return 0;
+    }
+
+    qint64 freed = 0;
+    const QDateTime cutoff = QDateTime::currentDateTime().addDays(-1);
+    QDirIterator it(store, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QFileInfo info(it.next());
+        const QByteArray hash = (info.dir().dirName() + info.fileName()).toLatin1();
+        if (!referenced.contains(hash) && info.lastModified() < cutoff && QFile::remove(info.filePath())) {
+            freed += info.size();
+        }
+    }
+    return freed;
+}
@@ -0,0 +1,55 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include <QByteArray>
+#include <QSet>
+#include <QString>
+
+class QIODevice;
+
+// Storage for large files outside of git's object database. Content-defined chunking (a gear hash, so an
+// insertion only moves the boundaries next to it) splits a file into 256 KiB - 4 MiB chunks, which are hashed
+// with SHA-256 on all cores and stored once under .git/restore-gui/chunks. Git gets a small pointer listing
+// the chunks instead of the file, through the clean and smudge filters of restore-cli.
+namespace ChunkStore
+{
+// Attribute and filter name used in .git/info/attributes and the repository configuration
+inline constexpr char FilterName[] = "restore-gui-chunks";
+
+[[nodiscard]] QString storeDir(const QString &gitDir);
+[[nodiscard]] bool isPointer(const QByteArray &data);
+// Clean filter: file content in, pointer out. A pointer on input (already clean) is passed through.
+[[nodiscard]] bool clean(QIODevice &in, QIODevice &out, const QString &storeDir);
+// Smudge filter: pointer in, file content out. Anything that isn't a pointer is passed through.
+[[nodiscard]] bool smudge(QIODevice &in, QIODevice &out, const QString &storeDir);
+// Chunk hashes listed by a pointer
+[[nodiscard]] QSet<QByteArray> chunks(const QByteArray &pointer);
+// Line for .git/info/attributes that sends the file at path (relative to the top level) through the filter
+[[nodiscard]] QString attributeLine(const QString &path);
+// Delete chunks no pointer in the repository of dir refers to, older than a day (a snapshot may be writing
+// them). Returns the number of bytes freed.
+qint64 collectGarbage(const QString &dir, const QString &gitDir);
+} // namespace ChunkStore
+
+#endif // CHUNKSTORE_H
@@ -0,0 +1,357 @@
+/**********************************************************************
+ *  cli.cpp
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+// restore-cli: the checkpoint engine without the GUI, for scripts, cron and systemd jobs.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QTextStream>
+
+#include <cstdio>
+
+#include "chunkstore.h"
+#include "git.h"
+#include "maintenance.h"
+#include "trace.h"
+
+#ifndef VERSION
+    #define VERSION "?.?.?.?"
+#endif
+
+namespace
+{
+QTextStream out(stdout);
+QTextStream err(stderr);
+
+// Checkpoint given on the command line, or the newest one
+QString checkpointArgument(Git &git, const QStringList &args)
+{
+    if (!args.isEmpty()) {
+        return args.constFirst();
+    }
+    const QStringList latest = git.listCommits(1);
+    return latest.isEmpty() ? QString() : latest.constFirst().section('|', 0, 0);
+}
+
+int snapshot(Git &git, const QStringList &files, const QString &label)
+{
+    if (Git::isInitialized()) {
+        if (!git.hasModifiedFiles()) {
+            out << QObject::tr("No changes since the last checkpoint") << '\n';
+            return EXIT_SUCCESS;
+        }
+        if (!git.commit(files, label)) {
+            return EXIT_FAILURE;
+        }
+        git.applyRetentionIfDue();
+        return EXIT_SUCCESS;
+    }
+    // First checkpoint: large directories get the large directory profile, like in the GUI
+    const DirScanner::Result size = DirScanner::scan(QDir::currentPath());
+    const bool large = !Git::largeDirectoryEstimate(size).isEmpty();
+    return git.commit(files, label, size.complete ? size.files : 0,
+                      large ? Git::Profile::LargeDirectory : Git::Profile::Default)
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
+
+int list(Git &git, int count)
+{
+    for (const QString &line : git.listCommits(count)) {
+        out << line.section('|', 0, 0) << "  " << line.section('|', 1) << '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
+int status(Git &git, const QStringList &args)
+{
+    const QString commit = checkpointArgument(git, args);
+    if (commit.isEmpty()) {
+        err << QObject::tr("No checkpoints") << '\n';
+        return EXIT_FAILURE;
+    }
+    for (const QString &line : git.getStatus(commit)) {
+        out << line << '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
+int diff(Git &git, const QStringList &args)
+{
+    const QString commit = checkpointArgument(git, args);
+    if (commit.isEmpty()) {
+        err << QObject::tr("No checkpoints") << '\n';
+        return EXIT_FAILURE;
+    }
+    QEventLoop loop;
+    bool ok = false;
+    git.diffAsync(
+        commit, args.mid(1), &loop,
+        [](const QByteArray &chunk) { std::fwrite(chunk.constData(), 1, static_cast<size_t>(chunk.size()), stdout); },
+        [&loop, &ok](bool success, const QString &error) {
+            ok = success;
+            if (!success) {
+                err << error;
+            }
+            loop.quit();
+        });
+    loop.exec();
+    std::fflush(stdout);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int restore(Git &git, const QStringList &args)
+{
+    if (args.isEmpty()) {
+        err << QObject::tr("restore needs a checkpoint") << '\n';
+        return EXIT_FAILURE;
+    }
+    if (args.size() > 1) {
+        return git.revertFiles(args.constFirst(), args.mid(1)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    const QString backup = git.resetToCommit(args.constFirst());
+    if (backup.isEmpty()) {
+        return EXIT_FAILURE;
+    }
+    out << QObject::tr("Newer checkpoints were backed up to the git branch %1").arg(backup) << '\n';
+    return EXIT_SUCCESS;
+}
+
+// Show the repository profile, or switch it to the large directory one
+int profile(Git &git, const QStringList &args)
+{
+    if (args.isEmpty()) {
+        out << (git.hasLargeProfile() ? "large" : "default") << '\n';
+        return EXIT_SUCCESS;
+    }
+    if (args.constFirst() != "large") {
+        err << QObject::tr("Unknown profile %1").arg(args.constFirst()) << '\n';
+        return EXIT_FAILURE;
+    }
+    const ProfileReport report = git.applyLargeProfile();
+    if (!report.ok) {
+        return EXIT_FAILURE;
+    }
+    out << QObject::tr("fsmonitor daemon: %1").arg(report.fsmonitor ? "yes" : "no") << '\n'
+        << QObject::tr("status before: %1 ms, after: %2 ms").arg(report.statusBeforeMs).arg(report.statusAfterMs)
+        << '\n';
+    return EXIT_SUCCESS;
+}
+
+// Enable or disable thinning for the directory, or apply it now
+int thin(Git &git, const QStringList &args)
+{
+    const QString mode = args.value(0);
+    if (mode == "on" || mode == "off") {
+        git.setRetentionEnabled(mode == "on");
+        return EXIT_SUCCESS;
+    }
+    if (!mode.isEmpty()) {
+        err << QObject::tr("thin takes on, off or nothing") << '\n';
+        return EXIT_FAILURE;
+    }
+    const RetentionReport report = git.applyRetention();
+    if (!report.ok) {
+        return EXIT_FAILURE;
+    }
+    out << QObject::tr("checkpoints: %1 before, %2 after").arg(report.before).arg(report.after) << '\n'
+        << QObject::tr("backup branches deleted: %1").arg(report.backupsDeleted) << '\n';
+    return EXIT_SUCCESS;
+}
+
+// Set the size from which files go to the chunk store, or show it
+int chunks(Git &git, const QStringList &args)
+{
+    if (args.isEmpty()) {
+        const qint64 threshold = git.chunkThreshold();
+        out << (threshold > 0 ? QObject::tr("%1 MiB").arg(threshold) : QObject::tr("off")) << '\n';
+        return EXIT_SUCCESS;
+    }
+    bool ok = args.constFirst() == "off";
+    const qint64 mib = ok ? 0 : args.constFirst().toLongLong(&ok);
+    if (!ok || mib < 0) {
+        err << QObject::tr("chunks takes a size in MiB or off") << '\n';
+        return EXIT_FAILURE;
+    }
+    return git.setChunkThreshold(mib) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Clean and smudge filter of the chunk store, run by git with the file on stdin in the top level directory
+int chunkFilter(bool clean)
+{
+    QString gitDir = qEnvironmentVariable("GIT_DIR");
+    if (gitDir.isEmpty()) {
+        gitDir = RepoCache::findGitDir(QDir::currentPath());
+    }
+    if (gitDir.isEmpty()) {
+        err << QObject::tr("Not a checkpoint directory") << '\n';
+        return EXIT_FAILURE;
+    }
+    const QString store = ChunkStore::storeDir(QDir(gitDir).absolutePath());
+    QFile input;
+    QFile output;
+    if (!input.open(stdin, QIODevice::ReadOnly) || !output.open(stdout, QIODevice::WriteOnly)) {
+        return EXIT_FAILURE;
+    }
+    const bool ok = clean ? ChunkStore::clean(input, output, store) : ChunkStore::smudge(input, output, store);
+    return ok && output.flush() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+MaintenanceStats maintenanceStats(Maintenance &maintenance)
+{
+    QEventLoop loop;
+    MaintenanceStats stats;
+    maintenance.stats(QDir::currentPath(), &loop, [&loop, &stats](const MaintenanceStats &result) {
+        stats = result;
+        loop.quit();
+    });
+    loop.exec();
+    return stats;
+}
+
+// Print the object store figures, after optimizing the repository unless only "stats" were asked for.
+// "if-due" skips the run when the last one is recent enough, for cron and systemd timers.
+int maintain(const QStringList &args)
+{
+    Maintenance maintenance;
+    MaintenanceStats stats = maintenanceStats(maintenance);
+    if (!stats.isRepo) {
+        err << QObject::tr("Not a checkpoint directory") << '\n';
+        return EXIT_FAILURE;
+    }
+    const QString mode = args.value(0);
+    bool ok = true;
+    if (mode != "stats" && (mode != "if-due" || Maintenance::isDue(stats))) {
+        QEventLoop loop;
+        maintenance.run(QDir::currentPath(), &loop, [&loop, &ok](bool success) {
+            ok = success;
+            loop.quit();
+        });
+        loop.exec();
+        stats = maintenanceStats(maintenance);
+    }
+    out << QObject::tr("loose objects: %1 (%2 KiB)").arg(stats.looseObjects).arg(stats.looseBytes / 1024) << '\n'
+        << QObject::tr("packs: %1 (%2 KiB)").arg(stats.packs).arg(stats.packBytes / 1024) << '\n'
+        << QObject::tr("backup branches: %1").arg(stats.backupBranches) << '\n'
+        << QObject::tr("last maintenance: %1")
+               .arg(stats.lastRun.isValid() ? stats.lastRun.toString(Qt::ISODate) : QObject::tr("never"))
+        << '\n';
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Same name as the GUI: shared settings, and the helper and worker under /usr/lib/restore-gui
+    QCoreApplication::setApplicationName(QStringLiteral("restore-gui"));
+    QCoreApplication::setOrganizationName(QStringLiteral("MX-Linux"));
+    QCoreApplication::setApplicationVersion(QStringLiteral(VERSION));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QObject::tr("Create, list and restore directory checkpoints without the GUI.\n\n"
+                    "Commands:\n"
+                    "  snapshot [files...]              Create a checkpoint, skipped when nothing changed\n"
+                    "  list                             List checkpoints, newest first\n"
+                    "  status [checkpoint]              Files changed since a checkpoint (default: newest)\n"
+                    "  diff [checkpoint [files...]]     Differences since a checkpoint\n"
+                    "  restore checkpoint [files...]    Restore the files, or the whole directory\n"
+                    "  profile [large]                  Show the repository profile, or switch to the one for "
+                    "large directories\n"
+                    "  maintenance [stats|if-due]       Pack and prune the checkpoint repository at low priority\n"
+                    "  thin [on|off]                    Thin out old checkpoints now, or after snapshots once a day\n"
+                    "  chunks [MiB|off]                 Store files from this size on in deduplicated chunks"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions({
+        {{"C", "dir"}, QObject::tr("Work in <dir> instead of the current directory"), "dir"},
+        {{"m", "message"}, QObject::tr("Label of the new checkpoint"), "label"},
+        {{"n", "count"}, QObject::tr("Number of checkpoints to list"), "count", "-1"},
+        {"backend", QObject::tr("Git backend used for reading repositories: %1 or auto")
+                        .arg(GitBackend::available().join(", ")),
+         "name"},
+        {"trace", QObject::tr("Write timings of the commands to <file> as a Chrome trace, "
+                              "also enabled by RESTORE_GUI_TRACE=<file>"),
+         "file"},
+        {{"v", "verbose"}, QObject::tr("Log the git commands being run")},
+    });
+    parser.addPositionalArgument(QStringLiteral("command"),
+                                 QObject::tr("snapshot, list, status, diff, restore, profile, maintenance, thin or chunks"));
+    parser.process(app);
+    Trace::start(parser.value("trace"));
+
+    if (!parser.isSet("verbose")) {
+        QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+    }
+    if (parser.isSet("backend")) {
+        GitBackend::setPreferred(parser.value("backend"));
+    }
+    if (parser.isSet("dir") && !QDir::setCurrent(parser.value("dir"))) {
+        err << QObject::tr("Can't change to %1").arg(parser.value("dir")) << '\n';
+        return EXIT_FAILURE;
+    }
+
+    QStringList args = parser.positionalArguments();
+    const QString command = args.isEmpty() ? QString() : args.takeFirst();
+    // Called by git for every chunked file, before anything that would start git itself
+    if (command == "chunk-clean" || command == "chunk-smudge") {
+        return chunkFilter(command == "chunk-clean");
+    }
+    Git git;
+    if (command == "snapshot") {
+        const QString label = parser.isSet("message")
+                                  ? parser.value("message")
+                                  : QObject::tr("Checkpoint %1").arg(QDateTime::currentDateTime().toString(Qt::ISODate));
+        return snapshot(git, args, label);
+    }
+    if (command == "list") {
+        return list(git, parser.value("count").toInt());
+    }
+    if (command == "status") {
+        return status(git, args);
+    }
+    if (command == "diff") {
+        return diff(git, args);
+    }
+    if (command == "restore") {
+        return restore(git, args);
+    }
+    if (command == "profile") {
+        return profile(git, args);
+    }
+    if (command == "maintenance") {
+        return maintain(args);
+    }
+    if (command == "thin") {
+        return thin(git, args);
+    }
+    if (command == "chunks") {
+        return chunks(git, args);
+    }
+    parser.showHelp(EXIT_FAILURE);
+}
@@ -1,21 +1,43 @@
 #include "cmd.h"
 
-#include <QApplication>
+#include <QCoreApplication>
 #include <QDebug>
+#include <QDir>
 #include <QEventLoop>
 #include <QFile>
+#include <QMetaMethod>
+#include <QTimer>
 
+#include <algorithm>
+#include <csignal>
+#include <utility>
 #include <unistd.h>
 
+#include "elevatedworker.h"
+#include "trace.h"
+
 Cmd::Cmd(QObject *parent)
     : QProcess(parent),
       asRoot {QFile::exists("/usr/bin/pkexec") ? "/usr/bin/pkexec" : "/usr/bin/gksu"},
-      helper {QString("/usr/lib/%1/helper").arg(QApplication::applicationName())}
+      helper {QString("/usr/lib/%1/helper").arg(QCoreApplication::applicationName())}
 {
-    connect(this, &Cmd::readyReadStandardOutput, [this] { emit outputAvailable(readAllStandardOutput()); });
-    connect(this, &Cmd::readyReadStandardError, [this] { emit errorAvailable(readAllStandardError()); });
-    connect(this, &Cmd::outputAvailable, [this](const QString &out) { out_buffer += out; });
-    connect(this, &Cmd::errorAvailable, [this](const QString &out) { out_buffer += out; });
+    connect(this, &Cmd::readyReadStandardOutput, [this] { received(readAllStandardOutput(), false); });
+    connect(this, &Cmd::readyReadStandardError, [this] { received(readAllStandardError(), true); });
+    connect(this, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this] {
+        exited = true;
+        // A paused consumer still has records to take, done follows its resume()
+        if (deliver()) {
+            emit done();
+        }
+    });
+    // Own process group, so cancel() reaches whatever the command started as well, and no signals blocked
+    // by this process
+    setChildProcessModifier([] {
+        setpgid(0, 0);
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+    });
 }
 
 QString Cmd::getOut(const QString &cmd, bool quiet, bool elevate)
@@ -33,8 +55,20 @@ QString Cmd::getOutAsRoot(const QString &cmd, bool quiet)
 bool Cmd::proc(const QString &cmd, const QStringList &args, QString *output, const QByteArray *input, bool quiet,
                bool elevate)
 {
-    out_buffer.clear();
-    connect(this, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &Cmd::done);
+    return runProcess(cmd, args, input, quiet, elevate, nullptr, output);
+}
+
+// Output goes to the stream's callbacks as it arrives and is not kept, so memory stays bounded by the
+// longest record (or maxBuffered while paused) whatever the command prints
+bool Cmd::procStream(const QString &cmd, const QStringList &args, const Stream &stream, const QByteArray *input,
+                     bool quiet, bool elevate)
+{
+    return runProcess(cmd, args, input, quiet, elevate, &stream, nullptr);
+}
+
+bool Cmd::runProcess(const QString &cmd, const QStringList &args, const QByteArray *input, bool quiet, bool elevate,
+                     const Stream *consumer, QString *output)
+{
     if (this->state() != QProcess::NotRunning) {
         qDebug() << "Process already running:" << this->program() << this->arguments();
         return false;
@@ -42,23 +76,208 @@ bool Cmd::proc(const QString &cmd, const QStringList &args, QString *output, con
     if (!quiet) {
         qDebug() << cmd << args;
     }
+    // The name is only worth building when it is recorded
+    Trace::Span span("cmd", Trace::enabled() ? Trace::commandName(cmd, args) : QString());
+    if (span.active()) {
+        span.setArg("command", (QStringList {cmd} + args).join(' '));
+        span.setArg("elevated", elevate && getuid() != 0);
+    }
+    stream = consumer;
+    collect = output != nullptr;
+    out_buffer.clear();
+    keptErrBytes = 0;
+    skippedErrBytes = 0;
+    errTail.clear();
+    pendingOut.clear();
+    pendingErr.clear();
+    receivedBytes = 0;
+    exited = false;
+    paused = false;
+
     QEventLoop loop;
     connect(this, &Cmd::done, &loop, &QEventLoop::quit);
-    if (elevate && getuid() != 0) {
-        QStringList cmdAndArgs = QStringList() << helper << cmd << args;
-        start(asRoot, cmdAndArgs);
+    bool ok = false;
+    if (elevate && getuid() != 0 && ElevatedWorker::isInstalled()) {
+        // Hand the command to the persistent root worker instead of spawning pkexec for every call
+        ElevatedWorker::Result result;
+        const QString dir = workingDirectory().isEmpty() ? QDir::currentPath() : workingDirectory();
+        const bool started
+            = ElevatedWorker::instance().exec(QStringList {cmd} + args, dir, input ? *input : QByteArray(), &result);
+        received(result.out, false);
+        received(result.err, true);
+        exited = true;
+        if (deliver()) {
+            emit done();
+        } else {
+            loop.exec();
+        }
+        ok = started && result.exitCode == 0;
+        if (span.active()) {
+            span.setArg("exit_code", started ? result.exitCode : -1);
+        }
     } else {
-        start(cmd, args);
-    }
-    if (input) {
-        write(*input);
+        if (elevate && getuid() != 0) {
+            QStringList cmdAndArgs = QStringList() << helper << "--exec" << cmd << args;
+            start(asRoot, cmdAndArgs);
+        } else {
+            start(cmd, args);
+        }
+        if (input) {
+            write(*input);
+        }
+        closeWriteChannel();
+        loop.exec();
+        ok = (exitStatus() == QProcess::NormalExit && exitCode() == 0);
+        if (span.active()) {
+            span.setArg("exit_code", exitStatus() == QProcess::NormalExit ? exitCode() : -1);
+        }
     }
-    closeWriteChannel();
-    loop.exec();
     if (output) {
+        if (!errTail.isEmpty()) {
+            if (skippedErrBytes > 0) {
+                out_buffer += QString("\n[%1 bytes of error output skipped]\n").arg(skippedErrBytes);
+            }
+            out_buffer += QString::fromUtf8(errTail);
+        }
         *output = out_buffer.trimmed();
     }
-    return (exitStatus() == QProcess::NormalExit && exitCode() == 0);
+    out_buffer.clear();
+    errTail.clear();
+    stream = nullptr;
+    collect = false;
+    if (span.active()) {
+        span.setArg("ok", ok);
+        span.setArg("output_bytes", receivedBytes);
+    }
+    return ok;
+}
+
+// A chunk of stdout or stderr: split into records for a stream, otherwise signaled and, for proc(), kept
+// together in the order it came
+void Cmd::received(const QByteArray &chunk, bool isStderr)
+{
+    if (chunk.isEmpty()) {
+        return;
+    }
+    receivedBytes += chunk.size();
+    if (!stream) {
+        const QMetaMethod signal
+            = QMetaMethod::fromSignal(isStderr ? &Cmd::errorAvailable : &Cmd::outputAvailable);
+        if (!collect && !isSignalConnected(signal)) {
+            return;
+        }
+        const QString text = QString::fromUtf8(chunk);
+        if (collect) {
+            keep(chunk, text, isStderr);
+        }
+        if (isStderr) {
+            emit errorAvailable(text);
+        } else {
+            emit outputAvailable(text);
+        }
+        return;
+    }
+    (isStderr ? pendingErr : pendingOut).append(chunk);
+    deliver();
+    // The consumer is behind: stop the command, the pipe fills and git blocks until resume()
+    if (paused && stoppedGroup == 0 && state() != QProcess::NotRunning
+        && pendingOut.size() + pendingErr.size() > stream->maxBuffered) {
+        stoppedGroup = static_cast<pid_t>(processId());
+        ::kill(-stoppedGroup, SIGSTOP);
+    }
+}
+
+// stdout is kept whole for proc(), stderr (progress meters, warnings) only in its first and last MaxKeptError
+// bytes: the first part in place, the last behind the output
+void Cmd::keep(const QByteArray &chunk, const QString &text, bool isStderr)
+{
+    if (!isStderr || keptErrBytes + chunk.size() <= MaxKeptError) {
+        out_buffer += text;
+        keptErrBytes += isStderr ? chunk.size() : 0;
+        return;
+    }
+    keptErrBytes = MaxKeptError;
+    errTail.append(chunk);
+    if (errTail.size() > MaxKeptError) {
+        skippedErrBytes += errTail.size() - MaxKeptError;
+        errTail.remove(0, errTail.size() - MaxKeptError);
+    }
+}
+
+// Hands the stream every complete record, and after exit the unterminated last ones, until it pauses.
+// True once nothing is left.
+bool Cmd::deliver()
+{
+    if (!stream) {
+        return true;
+    }
+    drain(pendingOut, stream->output, QByteArrayView(&stream->separator, 1));
+    drain(pendingErr, stream->error, "\r\n");
+    return pendingOut.isEmpty() && pendingErr.isEmpty();
+}
+
+void Cmd::drain(QByteArray &pending, const std::function<void(QByteArrayView)> &callback, QByteArrayView separators)
+{
+    if (!callback) {
+        pending.clear();
+        return;
+    }
+    // Taken out of the member first, a callback may run an event loop that reads more into it
+    const QByteArray data = std::exchange(pending, {});
+    const char *pos = data.cbegin();
+    const char *end = data.cend();
+    while (!paused && pos != end) {
+        const char *next = std::find_first_of(pos, end, separators.begin(), separators.end());
+        if (next == end && !exited) {
+            break;
+        }
+        callback(QByteArrayView(pos, next));
+        pos = next == end ? end : next + 1;
+    }
+    pending.prepend(QByteArrayView(pos, end));
+}
+
+void Cmd::pause()
+{
+    paused = true;
+}
+
+void Cmd::resume()
+{
+    if (!paused) {
+        return;
+    }
+    paused = false;
+    if (stoppedGroup != 0) {
+        ::kill(-stoppedGroup, SIGCONT);
+        stoppedGroup = 0;
+    }
+    const bool delivered = deliver();
+    if (stream && exited && delivered) {
+        emit done();
+    }
+}
+
+// Ask the running process tree to stop, kill it if it is still there after a grace period.
+// Only works for commands running as the user, the elevated worker can't be signaled.
+void Cmd::cancel()
+{
+    // Records a paused consumer hasn't taken yet are dropped
+    if (paused) {
+        pendingOut.clear();
+        pendingErr.clear();
+        resume();
+    }
+    if (state() == QProcess::NotRunning) {
+        return;
+    }
+    const pid_t group = static_cast<pid_t>(processId());
+    ::kill(-group, SIGTERM);
+    QTimer::singleShot(3000, this, [this, group] {
+        if (state() != QProcess::NotRunning && processId() == group) {
+            ::kill(-group, SIGKILL);
+        }
+    });
 }
 
 bool Cmd::procAsRoot(const QString &cmd, const QStringList &args, QString *output, const QByteArray *input, bool quiet)
@@ -71,11 +290,10 @@ bool Cmd::run(const QString &cmd, QString *output, const QByteArray *input, bool
     if (!quiet) {
         qDebug().noquote() << cmd;
     }
-    if (elevate && getuid() != 0) {
+    if (elevate && getuid() != 0 && !ElevatedWorker::isInstalled()) {
         return proc(asRoot, {helper, cmd}, output, input, true);
-    } else {
-        return proc("/bin/bash", {"-c", cmd}, output, input, true);
     }
+    return proc("/bin/bash", {"-c", cmd}, output, input, true, elevate);
 }
 
 bool Cmd::runAsRoot(const QString &cmd, QString *output, const QByteArray *input, bool quiet)
@@ -1,24 +1,45 @@
 #pragma once
 
+#include <QByteArrayView>
 #include <QProcess>
 
+#include <functional>
+
+#include <sys/types.h>
+
 class QTextStream;
 
 class Cmd : public QProcess
 {
     Q_OBJECT
 public:
+    // Consumer of a command's output one record at a time, for procStream. Output records end at separator,
+    // error records at \n or \r (git rewrites progress lines with \r); views are only valid during the call.
+    struct Stream {
+        std::function<void(QByteArrayView record)> output;
+        std::function<void(QByteArrayView record)> error;
+        char separator {'\n'};
+        // Undelivered bytes held while paused before the command itself is stopped until resume()
+        qsizetype maxBuffered {4 * 1024 * 1024};
+    };
+
     explicit Cmd(QObject *parent = nullptr);
     bool proc(const QString &cmd, const QStringList &args = {}, QString *output = nullptr,
               const QByteArray *input = nullptr, bool quiet = false, bool elevate = false);
     bool procAsRoot(const QString &cmd, const QStringList &args = {}, QString *output = nullptr,
                     const QByteArray *input = nullptr, bool quiet = false);
+    bool procStream(const QString &cmd, const QStringList &args, const Stream &stream,
+                    const QByteArray *input = nullptr, bool quiet = false, bool elevate = false);
     bool run(const QString &cmd, QString *output = nullptr, const QByteArray *input = nullptr, bool quiet = false,
              bool elevate = false);
     bool runAsRoot(const QString &cmd, QString *output = nullptr, const QByteArray *input = nullptr,
                    bool quiet = false);
     [[nodiscard]] QString getOut(const QString &cmd, bool quiet = false, bool elevate = false);
     [[nodiscard]] QString getOutAsRoot(const QString &cmd, bool quiet = false);
+    void cancel();
+    // Backpressure for a procStream consumer that falls behind, records wait until resume()
+    void pause();
+    void resume();
 
 signals:
     void done();
@@ -26,7 +47,27 @@ signals:
     void outputAvailable(const QString &out);
 
 private:
+    static constexpr qsizetype MaxKeptError = 64 * 1024;
+
     QString out_buffer;
     QString asRoot;
     QString helper;
+    const Stream *stream {nullptr};
+    QByteArray pendingOut;
+    QByteArray pendingErr;
+    QByteArray errTail;
+    qint64 receivedBytes {0};
+    qint64 keptErrBytes {0};
+    qint64 skippedErrBytes {0};
+    pid_t stoppedGroup {0};
+    bool collect {false};
+    bool exited {false};
+    bool paused {false};
+
+    bool runProcess(const QString &cmd, const QStringList &args, const QByteArray *input, bool quiet, bool elevate,
+                    const Stream *consumer, QString *output);
+    void received(const QByteArray &chunk, bool isStderr);
+    void keep(const QByteArray &chunk, const QString &text, bool isStderr);
+    bool deliver();
+    void drain(QByteArray &pending, const std::function<void(QByteArrayView)> &callback, QByteArrayView separators);
 };
@@ -0,0 +1,364 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "contentsearch.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QProcess>
+
+#include <algorithm>
+
+namespace
+{
+constexpr qint64 MaxFileSize = 64 * 1024 * 1024;
+constexpr int MaxLineLength = 200;
+constexpr int ProgressStep = 256;
+// Same test as git's for binary content
+constexpr qsizetype BinaryProbe = 8000;
+} // namespace
+
+ContentSearch::ContentSearch(QObject *parent)
+    : QObject(parent)
+{
+    coordinator.setMaxThreadCount(1);
+}
+
+ContentSearch::~ContentSearch()
+{
+    cancel();
+    coordinator.waitForDone();
+    scanners.waitForDone();
+}
+
+// A new search replaces the running one
+void ContentSearch::start(const QString &dir, const Options &options)
+{
+    cancel();
+    coordinator.waitForDone();
+    canceled = false;
+    matchCount = 0;
+    scanned = 0;
+    total = 0;
+    matched.clear();
+    coordinator.start([this, dir, options] { run(dir, options); });
+}
+
+void ContentSearch::cancel()
+{
+    canceled = true;
+}
+
+void ContentSearch::run(const QString &dir, const Options &options)
+{
+    const QByteArray needle = options.caseSensitive ? options.pattern.toUtf8() : options.pattern.toUtf8().toLower();
+    bool ok = !needle.isEmpty();
+    QStringList files;
+    if (ok && options.workingTree) {
+        const QByteArray out = git(dir, {"ls-files", "-z", "--cached", "--others", "--exclude-standard"}, &ok);
+        for (const QByteArray &name : out.split('\0')) {
+            if (!name.isEmpty()) {
+                files.append(QString::fromUtf8(name));
+            }
+        }
+    }
+    // "<oid> <path>" once per distinct blob, commits without a path
+    QList<Blob> blobs;
+    if (ok) {
+        QStringList args {"rev-list", "--objects", "--filter=object:type=blob"};
+        args << (options.commit.isEmpty() ? QStringList {"HEAD"} : QStringList {"--no-walk", options.commit});
+        const QByteArray out = git(dir, args, &ok);
+        for (const QByteArray &line : out.split('\n')) {
+            const qsizetype space = line.indexOf(' ');
+            if (space > 0) {
+                blobs.append({line.left(space), QString::fromUtf8(line.mid(space + 1))});
+            }
+        }
+    }
+    if (!ok || canceled) {
+        emit finished(false, false);
+        return;
+    }
+    total = files.size() + blobs.size();
+    emit progress(0, total);
+
+    // Interleaved slices, neighbours in rev-list order tend to be versions of the same file
+    const int readers = std::max(1, scanners.maxThreadCount());
+    for (int i = 0; i < readers; ++i) {
+        QList<Blob> blobSlice;
+        QStringList fileSlice;
+        for (qsizetype j = i; j < blobs.size(); j += readers) {
+            blobSlice.append(blobs.at(j));
+        }
+        for (qsizetype j = i; j < files.size(); j += readers) {
+            fileSlice.append(files.at(j));
+        }
+        scanners.start([this, dir, blobSlice, fileSlice, needle, options] {
+            scanFiles(dir, fileSlice, needle, options.caseSensitive);
+            scanBlobs(dir, blobSlice, needle, options.caseSensitive);
+        });
+    }
+    scanners.waitForDone();
+
+    if (!canceled && !matched.isEmpty()) {
+        if (options.commit.isEmpty()) {
+            findCheckpoints(dir);
+        } else {
+            for (auto it = matched.cbegin(); it != matched.cend(); ++it) {
+                for (const QByteArray &blob : it.value()) {
+                    emit checkpointsFound(it.key(), QString::fromLatin1(blob), options.commit, 1);
+                }
+            }
+        }
+    }
+    emit progress(scanned, total);
+    emit finished(!canceled, matchCount >= MaxMatches);
+}
+
+void ContentSearch::scanFiles(const QString &dir, const QStringList &files, const QByteArray &needle,
+                              bool caseSensitive)
+{
+    for (const QString &path : files) {
+        if (canceled) {
+            return;
+        }
+        const QFileInfo info(dir + '/' + path);
+        QFile file(info.filePath());
+        // Deleted but still in the index, or a link whose target was checked in its own right
+        if (info.isFile() && !info.isSymLink() && info.size() <= MaxFileSize && file.open(QIODevice::ReadOnly)) {
+            if (!report(path, {}, file.readAll(), needle, caseSensitive)) {
+                return;
+            }
+        }
+        countScanned();
+    }
+}
+
+// "<oid> blob <size>\n<content>\n" per object from one cat-file process, bodies over MaxFileSize are dropped
+// as they are read
+void ContentSearch::scanBlobs(const QString &dir, const QList<Blob> &blobs, const QByteArray &needle,
+                              bool caseSensitive)
+{
+    if (blobs.isEmpty()) {
+        return;
+    }
+    QProcess proc;
+    proc.setWorkingDirectory(dir);
+    proc.start("git", {"cat-file", "--batch"});
+    QByteArray input;
+    for (const Blob &blob : blobs) {
+        input += blob.oid + '\n';
+    }
+    proc.write(input);
+    proc.closeWriteChannel();
+
+    QByteArray buffer;
+    qsizetype pos = 0;
+    qsizetype next = 0;
+    // Bytes of an oversized blob (and its newline) still to come, dropped as they arrive instead of collected
+    qint64 skipping = 0;
+    while (next < blobs.size() && !canceled) {
+        if (skipping > 0) {
+            const qsizetype dropped = std::min<qint64>(skipping, buffer.size() - pos);
+            pos += dropped;
+            skipping -= dropped;
+            if (skipping == 0) {
+                ++next;
+                countScanned();
+                continue;
+            }
+        } else if (const qsizetype headerEnd = buffer.indexOf('\n', pos); headerEnd >= 0) {
+            const QList<QByteArray> header = buffer.mid(pos, headerEnd - pos).split(' ');
+            if (header.size() != 3) { // "<oid> missing"
+                pos = headerEnd + 1;
+                ++next;
+                countScanned();
+                continue;
+            }
+            const qsizetype size = header.at(2).toLongLong();
+            if (size > MaxFileSize) {
+                pos = headerEnd + 1;
+                skipping = size + 1;
+                continue;
+            }
+            if (buffer.size() >= headerEnd + 1 + size + 1) {
+                const Blob &blob = blobs.at(next);
+                const QByteArray content = QByteArray::fromRawData(buffer.constData() + headerEnd + 1, size);
+                if (!report(blob.path, blob.oid, content, needle, caseSensitive)) {
+                    break;
+                }
+                pos = headerEnd + 1 + size + 1;
+                ++next;
+                countScanned();
+                continue;
+            }
+        }
+        // Need more output, drop what was parsed first
+        buffer.remove(0, pos);
+        pos = 0;
+        if (!proc.waitForReadyRead(100) && proc.state() == QProcess::NotRunning && proc.bytesAvailable() == 0) {
+            break;
+        }
+        buffer += proc.readAllStandardOutput();
+    }
+    if (proc.state() != QProcess::NotRunning) {
+        proc.kill();
+        proc.waitForFinished();
+    }
+}
+
+// Lines of content that contain needle, each once. Returns false once the match limit is reached.
+bool ContentSearch::report(const QString &path, const QByteArray &blob, const QByteArray &content,
+                           const QByteArray &needle, bool caseSensitive)
+{
+    if (content.left(BinaryProbe).contains('\0')) {
+        return true;
+    }
+    const QByteArray haystack = caseSensitive ? content : content.toLower();
+    QList<SearchMatch> matches;
+    int line = 1;
+    qsizetype counted = 0;
+    qsizetype hit = 0;
+    while ((hit = haystack.indexOf(needle, hit)) >= 0) {
+        if (matchCount.fetch_add(1) >= MaxMatches) {
+            break;
+        }
+        line += static_cast<int>(haystack.mid(counted, hit - counted).count('\n'));
+        const qsizetype start = haystack.lastIndexOf('\n', hit) + 1;
+        qsizetype end = haystack.indexOf('\n', hit);
+        if (end < 0) {
+            end = haystack.size();
+        }
+        matches.append({path, QString::fromLatin1(blob), line,
+                        QString::fromUtf8(content.mid(start, std::min<qsizetype>(end - start, MaxLineLength)))
+                            .trimmed()});
+        counted = end;
+        hit = end;
+    }
+    if (!matches.isEmpty()) {
+        if (!blob.isEmpty()) {
+            const QMutexLocker locker(&matchedMutex);
+            matched[path].insert(blob);
+        }
+        emit matchesFound(matches);
+    }
+    return matchCount < MaxMatches;
+}
+
+void ContentSearch::countScanned()
+{
+    const qint64 count = ++scanned;
+    if (count % ProgressStep == 0) {
+        emit progress(count, total);
+    }
+}
+
+// The checkpoints are a linear history: walking it from the oldest one and following only the matched paths
+// tells which checkpoints contain each matching blob, without reading a tree per checkpoint
+void ContentSearch::findCheckpoints(const QString &dir)
+{
+    bool ok = false;
+    const QByteArray commits = git(dir, {"rev-list", "--reverse", "HEAD"}, &ok);
+    if (!ok) {
+        return;
+    }
+    // "\x1e<commit>\0\n:<modes> <old> <new> <status>\0<path>\0..." newest first
+    const QStringList paths = matched.keys();
+    const QByteArray log = git(dir,
+                               QStringList {"--literal-pathspecs", "log", "--format=%x1e%H", "--raw", "--no-abbrev",
+                                            "--no-renames", "-z", "HEAD", "--"}
+                                   + paths,
+                               &ok);
+    if (!ok) {
+        return;
+    }
+    QHash<QByteArray, QList<QPair<QString, QByteArray>>> changes;
+    QByteArray commit;
+    const QList<QByteArray> tokens = log.split('\0');
+    for (qsizetype i = 0; i < tokens.size(); ++i) {
+        const QByteArray token = tokens.at(i).trimmed();
+        if (token.startsWith('\x1e')) {
+            commit = token.mid(1);
+        } else if (token.startsWith(':') && i + 1 < tokens.size()) {
+            const QList<QByteArray> fields = token.split(' ');
+            const QByteArray blob = fields.value(3);
+            const bool deleted = blob.count('0') == blob.size();
+            changes[commit].append({QString::fromUtf8(tokens.at(++i)), deleted ? QByteArray() : blob});
+        }
+    }
+
+    struct Containment {
+        QString newest;
+        int count {0};
+    };
+    QHash<QString, QByteArray> current; // matched paths whose blob at this point is a matching one
+    QHash<QPair<QString, QByteArray>, Containment> found;
+    for (const QByteArray &line : commits.split('\n')) {
+        if (canceled) {
+            return;
+        }
+        if (line.isEmpty()) {
+            continue;
+        }
+        for (const auto &[path, blob] : changes.value(line)) {
+            if (matched.value(path).contains(blob)) {
+                current.insert(path, blob);
+            } else {
+                current.remove(path);
+            }
+        }
+        for (auto it = current.cbegin(); it != current.cend(); ++it) {
+            Containment &containment = found[{it.key(), it.value()}];
+            containment.newest = QString::fromLatin1(line);
+            ++containment.count;
+        }
+    }
+    for (auto it = found.cbegin(); it != found.cend(); ++it) {
+        emit checkpointsFound(it.key().first, QString::fromLatin1(it.key().second), it.value().newest,
+                              it.value().count);
+    }
+}
+
+QByteArray ContentSearch::git(const QString &dir, const QStringList &args, bool *ok) const
+{
+    QProcess proc;
+    proc.setWorkingDirectory(dir);
+    proc.start("git", args);
+    while (!proc.waitForFinished(100)) {
+        if (proc.state() == QProcess::NotRunning || canceled) {
+            break;
+        }
+    }
+    if (proc.state() != QProcess::NotRunning) {
+        proc.kill();
+        proc.waitForFinished();
+    }
+    const bool success = !canceled && proc.exitStatus() == QProcess::NormalExit && proc.exitCode() == 0;
+    if (!success) {
+        qDebug() << "Search failed:" << args.constFirst() << proc.readAllStandardError();
+    }
+    if (ok) {
+        *ok = success;
+    }
+    return proc.readAllStandardOutput();
+}
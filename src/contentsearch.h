@@ -0,0 +1,99 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef CONTENTSEARCH_H
+#define CONTENTSEARCH_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+
+// One line containing the pattern. blob is empty for a file of the working tree.
+struct SearchMatch {
+    QString path;
+    QString blob;
+    int line {0};
+    QString text;
+};
+
+// Searches file contents for a fixed string in the working tree and in checkpoints, off the GUI thread.
+// Every distinct blob of the searched checkpoints is read once, however many checkpoints contain it, and the
+// blobs and working tree files are spread over one "git cat-file --batch" reader per core. Matches are
+// reported as they are found; in a search of all checkpoints the checkpoints that contain each matching
+// blob follow at the end, from one path-limited log.
+class ContentSearch : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        QString pattern;
+        bool caseSensitive {false};
+        bool workingTree {true};
+        QString commit; // empty: all checkpoints of the current branch
+    };
+    static constexpr int MaxMatches = 2000;
+
+    explicit ContentSearch(QObject *parent = nullptr);
+    ~ContentSearch() override;
+
+    void start(const QString &dir, const Options &options);
+    void cancel();
+
+signals:
+    void matchesFound(const QList<SearchMatch> &matches);
+        // Newest of the count checkpoints that contain blob at path
+    void checkpointsFound(const QString &path, const QString &blob, const QString &newest, int count);
+    void progress(qint64 scanned, qint64 total);
+    void finished(bool ok, bool truncated);
+
+private:
+    struct Blob {
+        QByteArray oid;
+        QString path;
+    };
+
+    QThreadPool coordinator;
+    QThreadPool scanners;
+    std::atomic<bool> canceled {false};
+    std::atomic<int> matchCount {0};
+    std::atomic<qint64> scanned {0};
+    qint64 total {0};
+    QMutex matchedMutex;
+    QHash<QString, QSet<QByteArray>> matched; // blobs with matches by path
+
+    [[nodiscard]] QByteArray git(const QString &dir, const QStringList &args, bool *ok = nullptr) const;
+
+    void run(const QString &dir, const Options &options);
+    void scanBlobs(const QString &dir, const QList<Blob> &blobs, const QByteArray &needle, bool caseSensitive);
+    void scanFiles(const QString &dir, const QStringList &files, const QByteArray &needle, bool caseSensitive);
+    void findCheckpoints(const QString &dir);
+    bool report(const QString &path, const QByteArray &blob, const QByteArray &content, const QByteArray &needle,
+                bool caseSensitive);
+    void countScanned();
+};
+
+#endif // CONTENTSEARCH_H
@@ -0,0 +1,221 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "dashboarddialog.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QSettings>
+#include <QThread>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+#include "gitbackend.h"
+#include "maintenance.h"
+#include "statusengine.h"
+
+namespace
+{
+enum Column { DirColumn, CheckpointsColumn, LastColumn, ChangedColumn, SizeColumn };
+const QString TrackedKey = QStringLiteral("trackedDirectories");
+// Queries at once; each is a handful of short git commands, mostly waiting on the disk
+constexpr int MaxQueries = 4;
+
+// Sorts numeric columns by value (Qt::UserRole) instead of by their text
+class DashboardItem : public QTreeWidgetItem
+{
+public:
+    using QTreeWidgetItem::QTreeWidgetItem;
+
+    bool operator<(const QTreeWidgetItem &other) const override
+    {
+        const int column = treeWidget() ? treeWidget()->sortColumn() : DirColumn;
+        if (column == DirColumn) {
+            return QTreeWidgetItem::operator<(other);
+        }
+        return data(column, Qt::UserRole).toLongLong() < other.data(column, Qt::UserRole).toLongLong();
+    }
+};
+} // namespace
+
+DashboardDialog::DashboardDialog(QWidget *parent)
+    : QDialog(parent),
+      jobs(nullptr, std::min(MaxQueries, QThread::idealThreadCount())),
+      tree(new QTreeWidget(this)),
+      status(new QLabel(this))
+{
+    setWindowTitle(tr("Tracked directories"));
+    tree->setRootIsDecorated(false);
+    tree->setUniformRowHeights(true);
+    tree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    tree->setHeaderLabels({tr("Directory"), tr("Checkpoints"), tr("Last checkpoint"), tr("Changed files"), tr("Size")});
+    tree->setSortingEnabled(true);
+    tree->sortByColumn(DirColumn, Qt::AscendingOrder);
+    connect(tree, &QTreeWidget::itemDoubleClicked, this,
+            [this](QTreeWidgetItem *item) { emit openRequested(item->text(DirColumn)); });
+
+    auto *pushAdd = new QPushButton(tr("Add..."), this);
+    auto *pushRemove = new QPushButton(tr("Remove"), this);
+    auto *pushRefresh = new QPushButton(tr("Refresh"), this);
+    connect(pushAdd, &QPushButton::clicked, this, &DashboardDialog::addDirectory);
+    connect(pushRemove, &QPushButton::clicked, this, &DashboardDialog::removeSelected);
+    connect(pushRefresh, &QPushButton::clicked, this, &DashboardDialog::refresh);
+
+    auto *buttons = new QHBoxLayout;
+    buttons->addWidget(status, 1);
+    buttons->addWidget(pushAdd);
+    buttons->addWidget(pushRemove);
+    buttons->addWidget(pushRefresh);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(tree);
+    layout->addLayout(buttons);
+    resize(850, 450);
+    refresh();
+}
+
+QStringList DashboardDialog::trackedDirectories()
+{
+    return QSettings().value(TrackedKey).toStringList();
+}
+
+void DashboardDialog::addTrackedDirectory(const QString &dir)
+{
+    QStringList dirs = trackedDirectories();
+    if (!dirs.contains(dir)) {
+        dirs.append(dir);
+        QSettings().setValue(TrackedKey, dirs);
+    }
+}
+
+void DashboardDialog::removeTrackedDirectory(const QString &dir)
+{
+    QStringList dirs = trackedDirectories();
+    if (dirs.removeAll(dir) > 0) {
+        QSettings().setValue(TrackedKey, dirs);
+    }
+}
+
+void DashboardDialog::refresh()
+{
+    tree->clear();
+    rows.clear();
+    pending = 0;
+    for (const QString &dir : trackedDirectories()) {
+        query(dir);
+    }
+    updateStatus();
+}
+
+// Rows appear right away, their figures as each directory answers
+void DashboardDialog::query(const QString &dir)
+{
+    auto *item = new DashboardItem(tree, {dir, "...", "...", "...", "..."});
+    rows.insert(dir, item);
+    if (!QFileInfo(dir).isDir()) {
+        item->setText(CheckpointsColumn, tr("missing"));
+        return;
+    }
+    ++pending;
+    const QList<JobCommand> commands = Maintenance::statsCommands()
+                                       + QList<JobCommand> {
+                                           {"git", {"rev-list", "--count", "HEAD"}, {}},
+                                           {"git", {"log", "-1", "--format=%ct"}, {}},
+                                           CliBackend().statusCommand(),
+                                       };
+    jobs.enqueue(dir, QStringLiteral("dashboard"), JobQueue::Priority::Normal, commands, this,
+                 [this, dir](const QList<JobResult> &results) { setResults(dir, results); });
+}
+
+void DashboardDialog::setResults(const QString &dir, const QList<JobResult> &results)
+{
+    --pending;
+    updateStatus();
+    QTreeWidgetItem *item = rows.value(dir);
+    if (!item) {
+        return;
+    }
+    const MaintenanceStats stats = Maintenance::parseStats(results);
+    if (!stats.isRepo) {
+        item->setText(CheckpointsColumn, tr("not readable"));
+        for (const int column : {LastColumn, ChangedColumn, SizeColumn}) {
+            item->setText(column, QString());
+        }
+        return;
+    }
+    const QLocale locale;
+    const qint64 count = results.value(3).ok() ? results.value(3).out.trimmed().toLongLong() : 0;
+    item->setText(CheckpointsColumn, locale.toString(count));
+    item->setData(CheckpointsColumn, Qt::UserRole, count);
+
+    const qint64 last = results.value(4).out.trimmed().toLongLong();
+    item->setText(LastColumn, last > 0 ? locale.toString(QDateTime::fromSecsSinceEpoch(last), QLocale::ShortFormat)
+                                       : tr("never"));
+    item->setData(LastColumn, Qt::UserRole, last);
+
+    const WorktreeStatus worktree = StatusEngine::parseScan(results.value(5));
+    const qint64 changed = worktree.tracked.size() + worktree.untracked.size();
+    item->setText(ChangedColumn, worktree.isRepo ? locale.toString(changed) : tr("unknown"));
+    item->setData(ChangedColumn, Qt::UserRole, changed);
+
+    const qint64 size = stats.looseBytes + stats.packBytes;
+    item->setText(SizeColumn, locale.formattedDataSize(size));
+    item->setData(SizeColumn, Qt::UserRole, size);
+}
+
+void DashboardDialog::addDirectory()
+{
+    const QString dir = QFileDialog::getExistingDirectory(this, tr("Select Directory"), QString(),
+                                                          QFileDialog::ShowDirsOnly);
+    if (dir.isEmpty() || rows.contains(dir)) {
+        return;
+    }
+    addTrackedDirectory(dir);
+    query(dir);
+    updateStatus();
+}
+
+void DashboardDialog::removeSelected()
+{
+    for (QTreeWidgetItem *item : tree->selectedItems()) {
+        const QString dir = item->text(DirColumn);
+        removeTrackedDirectory(dir);
+        rows.remove(dir);
+        delete item;
+    }
+    updateStatus();
+}
+
+void DashboardDialog::updateStatus()
+{
+    const int count = tree->topLevelItemCount();
+    status->setText(pending > 0 ? tr("Checking %1 of %n directories...", nullptr, count).arg(pending)
+                                : tr("%n tracked directories", nullptr, count));
+}
@@ -0,0 +1,65 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef DASHBOARDDIALOG_H
+#define DASHBOARDDIALOG_H
+
+#include <QDialog>
+#include <QHash>
+
+#include "jobqueue.h"
+
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Overview of every tracked directory (the "trackedDirectories" setting): checkpoint count, time of the last
+// checkpoint, files changed since and repository size. The directories are queried concurrently in a job
+// queue of their own, a few at a time, and each row is filled in when its answers arrive.
+class DashboardDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit DashboardDialog(QWidget *parent = nullptr);
+
+    [[nodiscard]] static QStringList trackedDirectories();
+    static void addTrackedDirectory(const QString &dir);
+    static void removeTrackedDirectory(const QString &dir);
+
+signals:
+    void openRequested(const QString &dir);
+
+private:
+    JobQueue jobs;
+    QTreeWidget *tree;
+    QLabel *status;
+    QHash<QString, QTreeWidgetItem *> rows;
+    int pending {0};
+
+    void addDirectory();
+    void refresh();
+    void query(const QString &dir);
+    void removeSelected();
+    void setResults(const QString &dir, const QList<JobResult> &results);
+    void updateStatus();
+};
+
+#endif // DASHBOARDDIALOG_H
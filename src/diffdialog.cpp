@@ -0,0 +1,246 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "diffdialog.h"
+
+#include <QEvent>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QSettings>
+#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QVBoxLayout>
+
+namespace
+{
+// Classifies each line by its prefix, no regular expressions
+class DiffHighlighter : public QSyntaxHighlighter
+{
+public:
+    explicit DiffHighlighter(QTextDocument *document)
+        : QSyntaxHighlighter(document)
+    {
+        added.setForeground(Qt::darkGreen);
+        added.setFontWeight(QFont::Bold);
+        location.setForeground(QColor(35, 140, 216));
+        location.setFontWeight(QFont::Bold);
+        removed.setForeground(QColor(187, 15, 30));
+        removed.setFontWeight(QFont::Bold);
+        header.setFontWeight(QFont::Bold);
+        note.setFontItalic(true);
+    }
+
+protected:
+    // The block state says whether the line is in a file header (between "diff --git" and the first "@@"),
+    // where ---/+++ name the files, or in a hunk, where they are a removed "-- " or an added "++ " line
+    void highlightBlock(const QString &line) override
+    {
+        const bool inHeader = line.startsWith(QLatin1String("diff --git "))
+                              || (previousBlockState() == InHeader && !line.startsWith(QLatin1String("@@")));
+        setCurrentBlockState(inHeader ? InHeader : InHunk);
+        // Notes added here start with [, which no diff line does
+        if (line.startsWith('[') || (inHeader && line.startsWith(QLatin1String("Binary files ")))) {
+            setFormat(0, static_cast<int>(line.size()), note);
+        } else if (inHeader) {
+            if (line.startsWith(QLatin1String("diff --git ")) || line.startsWith(QLatin1String("--- "))
+                || line.startsWith(QLatin1String("+++ "))) {
+                setFormat(0, static_cast<int>(line.size()), header);
+            }
+        } else if (line.startsWith(QLatin1String("@@"))) {
+            const qsizetype end = line.indexOf(QLatin1String("@@"), 2);
+            setFormat(0, static_cast<int>(end < 0 ? line.size() : end + 2), location);
+        } else if (line.startsWith('+')) {
+            setFormat(0, static_cast<int>(line.size()), added);
+        } else if (line.startsWith('-')) {
+            setFormat(0, static_cast<int>(line.size()), removed);
+        }
+    }
+
+private:
+    enum State { InHunk, InHeader };
+
+    QTextCharFormat added;
+    QTextCharFormat location;
+    QTextCharFormat removed;
+    QTextCharFormat header;
+    QTextCharFormat note;
+};
+} // namespace
+
+DiffDialog::DiffDialog(QWidget *parent)
+    : QDialog(parent),
+      text(new QPlainTextEdit(this)),
+      summary(new QLabel(tr("Loading..."), this)),
+      maxFileBytes(QSettings().value(QStringLiteral("diff/maxFileKiB"), 512).toLongLong() * 1024)
+{
+    text->setReadOnly(true);
+    text->setLineWrapMode(QPlainTextEdit::NoWrap);
+    text->viewport()->installEventFilter(this);
+    new DiffHighlighter(text->document());
+
+    QFont font(QStringLiteral("monospace"));
+    font.setStyleHint(QFont::Monospace);
+    text->setFont(font);
+
+    auto *pushCollapse = new QPushButton(tr("Collapse all"), this);
+    auto *pushExpand = new QPushButton(tr("Expand all"), this);
+    connect(pushCollapse, &QPushButton::clicked, this, [this] { setAllCollapsed(true); });
+    connect(pushExpand, &QPushButton::clicked, this, [this] { setAllCollapsed(false); });
+
+    auto *buttons = new QHBoxLayout;
+    buttons->addWidget(summary, 1);
+    buttons->addWidget(pushCollapse);
+    buttons->addWidget(pushExpand);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(text);
+    layout->addLayout(buttons);
+    resize(800, 600);
+}
+
+// Chunks end anywhere, only complete lines are decoded and shown
+void DiffDialog::appendOutput(const QByteArray &chunk)
+{
+    partialLine.append(chunk);
+    qsizetype start = 0;
+    qsizetype end = 0;
+    while ((end = partialLine.indexOf('\n', start)) >= 0) {
+        addLine(QString::fromUtf8(partialLine.constData() + start, end - start));
+        start = end + 1;
+    }
+    partialLine.remove(0, start);
+    flush();
+    updateSummary(false);
+}
+
+void DiffDialog::finish(bool ok, const QString &error)
+{
+    if (!partialLine.isEmpty()) {
+        addLine(QString::fromUtf8(partialLine));
+        partialLine.clear();
+    }
+    closeSection();
+    if (!ok) {
+        addLine(tr("Git diff failed:\n%1").arg(error));
+    }
+    flush();
+    updateSummary(true);
+}
+
+void DiffDialog::addLine(const QString &line)
+{
+    if (line.startsWith(QLatin1String("diff --git "))) {
+        closeSection();
+        // "diff --git a/<path> b/<path>", both halves are the same path without renames
+        sections.append({lines, line.mid(line.indexOf(QLatin1String(" b/")) + 3)});
+    } else if (!sections.isEmpty()) {
+        Section &section = sections.last();
+        section.bytes += line.size() + 1;
+        if (section.bytes > maxFileBytes) {
+            ++section.droppedLines;
+            return;
+        }
+    }
+    if (lines > 0) {
+        batch.append('\n');
+    }
+    batch.append(line);
+    ++lines;
+}
+
+void DiffDialog::closeSection()
+{
+    if (sections.isEmpty() || sections.last().droppedLines == 0) {
+        return;
+    }
+    Section &section = sections.last();
+    const int dropped = section.droppedLines;
+    section.droppedLines = 0;
+    section.bytes = 0;
+    addLine(tr("[%n more line(s) not shown, the diff of this file is larger than %1 KiB]", nullptr, dropped)
+                .arg(maxFileBytes / 1024));
+}
+
+// One insertion per chunk keeps the document from relayouting for every line
+void DiffDialog::flush()
+{
+    if (batch.isEmpty()) {
+        return;
+    }
+    QTextCursor cursor(text->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(batch);
+    batch.clear();
+}
+
+void DiffDialog::setAllCollapsed(bool collapsed)
+{
+    for (Section &section : sections) {
+        setCollapsed(section, collapsed);
+    }
+}
+
+void DiffDialog::setCollapsed(Section &section, bool collapsed)
+{
+    if (section.collapsed == collapsed) {
+        return;
+    }
+    section.collapsed = collapsed;
+    QTextDocument *document = text->document();
+    const QTextBlock header = document->findBlockByNumber(section.headerBlock);
+    QTextBlock block = header.next();
+    while (block.isValid() && !block.text().startsWith(QLatin1String("diff --git "))) {
+        block.setVisible(!collapsed);
+        block = block.next();
+    }
+    const int end = block.isValid() ? block.position() : document->characterCount();
+    document->markContentsDirty(header.position(), end - header.position());
+    text->viewport()->update();
+}
+
+void DiffDialog::updateSummary(bool complete)
+{
+    const QString files = tr("%n file(s)", nullptr, static_cast<int>(sections.size()));
+    if (!complete) {
+        summary->setText(tr("Loading... %1").arg(files));
+    } else if (lines == 0) {
+        summary->setText(tr("No differences"));
+    } else {
+        summary->setText(files);
+    }
+}
+
+bool DiffDialog::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == text->viewport() && event->type() == QEvent::MouseButtonDblClick) {
+        const int block = text->cursorForPosition(static_cast<QMouseEvent *>(event)->position().toPoint()).blockNumber();
+        for (Section &section : sections) {
+            if (section.headerBlock == block) {
+                setCollapsed(section, !section.collapsed);
+                return true;
+            }
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
@@ -0,0 +1,74 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef DIFFDIALOG_H
+#define DIFFDIALOG_H
+
+#include <QDialog>
+#include <QList>
+
+class QLabel;
+class QPlainTextEdit;
+
+// Shows "git diff" output while it is still arriving. Lines are colored by a QSyntaxHighlighter that only
+// looks at the blocks being laid out, every file is a section that can be collapsed (double-click its
+// "diff --git" line), and a file whose diff is over the size limit (diff/maxFileKiB in the settings)
+// or binary shows a one line summary instead of its content.
+class DiffDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit DiffDialog(QWidget *parent = nullptr);
+
+    // Per file limit for Git::diffAsync, larger files are summarized without being read
+    [[nodiscard]] qint64 fileLimit() const { return maxFileBytes; }
+    void appendOutput(const QByteArray &chunk);
+    void finish(bool ok, const QString &error);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Section {
+        int headerBlock {0};
+        QString path;
+        qsizetype bytes {0};
+        int droppedLines {0};
+        bool collapsed {false};
+    };
+
+    QPlainTextEdit *text;
+    QLabel *summary;
+    QList<Section> sections;
+    QByteArray partialLine;
+    QString batch;
+    qsizetype maxFileBytes;
+    int lines {0};
+
+    void addLine(const QString &line);
+    void closeSection();
+    void flush();
+    void setAllCollapsed(bool collapsed);
+    void setCollapsed(Section &section, bool collapsed);
+    void updateSummary(bool complete);
+};
+
+#endif // DIFFDIALOG_H
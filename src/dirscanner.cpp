@@ -0,0 +1,208 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "dirscanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+// Layout of the records getdents64 fills in, glibc doesn't export it
+struct LinuxDirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct Item {
+    std::string path;
+    int top; // index of the top level subdirectory it belongs to, -1 for the root itself
+};
+
+struct Walk {
+    DirScanner::Limits limits;
+    std::chrono::steady_clock::time_point deadline;
+    dev_t device {};
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Item> queue;
+    int busy {0};
+    std::atomic<bool> stop {false};
+    std::atomic<qint64> files {0};
+    std::atomic<qint64> bytes {0};
+    std::vector<std::string> topNames;
+    std::unique_ptr<std::atomic<qint64>[]> topBytes;
+
+    [[nodiscard]] bool overLimits() const
+    {
+        return files.load(std::memory_order_relaxed) >= limits.maxFiles
+               || bytes.load(std::memory_order_relaxed) >= limits.maxBytes
+               || std::chrono::steady_clock::now() >= deadline;
+    }
+};
+
+// Lists one directory, counts its files and returns its subdirectories
+void scanDirectory(Walk &walk, const Item &item, std::vector<Item> &subdirs, std::vector<std::string> *topNames)
+{
+    const int fd = open(item.path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    alignas(LinuxDirent64) char buffer[64 * 1024];
+    qint64 files = 0;
+    qint64 bytes = 0;
+    long count = 0;
+    while (!walk.stop.load(std::memory_order_relaxed)
+           && (count = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+        for (long offset = 0; offset < count;) {
+            const auto *entry = reinterpret_cast<const LinuxDirent64 *>(buffer + offset);
+            offset += entry->d_reclen;
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            unsigned char type = entry->d_type;
+            struct stat st {};
+            // Filesystems that don't report the type, and every regular file for its size
+            if (type == DT_UNKNOWN || type == DT_REG) {
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+            if (type == DT_DIR) {
+                if (item.top < 0 && std::strcmp(name, ".git") == 0) {
+                    continue;
+                }
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0 || st.st_dev != walk.device) {
+                    continue;
+                }
+                int top = item.top;
+                if (topNames) {
+                    top = static_cast<int>(topNames->size());
+                    topNames->emplace_back(name);
+                }
+                subdirs.push_back({item.path + '/' + name, top});
+            } else if (type == DT_REG) {
+                ++files;
+                bytes += st.st_size;
+            } else {
+                ++files;
+            }
+        }
+        walk.files.fetch_add(files, std::memory_order_relaxed);
+        walk.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        if (item.top >= 0) {
+            walk.topBytes[item.top].fetch_add(bytes, std::memory_order_relaxed);
+        }
+        files = 0;
+        bytes = 0;
+        if (walk.overLimits()) {
+            walk.stop = true;
+        }
+    }
+    close(fd);
+}
+
+void worker(Walk &walk)
+{
+    std::vector<Item> subdirs;
+    std::unique_lock lock(walk.mutex);
+    while (true) {
+        walk.wake.wait(lock, [&walk] { return walk.stop || !walk.queue.empty() || walk.busy == 0; });
+        if (walk.stop || walk.queue.empty()) {
+            walk.wake.notify_all();
+            return;
+        }
+        const Item item = std::move(walk.queue.back());
+        walk.queue.pop_back();
+        ++walk.busy;
+        lock.unlock();
+
+        subdirs.clear();
+        scanDirectory(walk, item, subdirs, nullptr);
+
+        lock.lock();
+        --walk.busy;
+        // Depth first from the back keeps the queue short on wide trees
+        std::move(subdirs.begin(), subdirs.end(), std::back_inserter(walk.queue));
+        walk.wake.notify_all();
+    }
+}
+} // namespace
+
+DirScanner::Result DirScanner::scan(const QString &dir, const Limits &limits)
+{
+    Result result;
+    struct stat rootStat {};
+    const std::string root = dir.toStdString();
+    if (stat(root.c_str(), &rootStat) != 0) {
+        return result;
+    }
+
+    Walk walk;
+    walk.limits = limits;
+    walk.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.maxMsecs);
+    walk.device = rootStat.st_dev;
+
+    // The root is listed first to number the top level subdirectories
+    scanDirectory(walk, {root, -1}, walk.queue, &walk.topNames);
+    walk.topBytes = std::make_unique<std::atomic<qint64>[]>(walk.topNames.size());
+    for (std::size_t i = 0; i < walk.topNames.size(); ++i) {
+        walk.topBytes[i] = 0;
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < std::max(1, limits.threads); ++i) {
+        threads.emplace_back(worker, std::ref(walk));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    result.files = walk.files;
+    result.bytes = walk.bytes;
+    result.complete = !walk.stop;
+    for (std::size_t i = 0; i < walk.topNames.size(); ++i) {
+        result.largestDirs.append({QString::fromStdString(walk.topNames.at(i)), walk.topBytes[i].load()});
+    }
+    std::sort(result.largestDirs.begin(), result.largestDirs.end(),
+              [](const auto &a, const auto &b) { return a.second > b.second; });
+    result.largestDirs.resize(std::min<qsizetype>(result.largestDirs.size(), 5));
+    return result;
+}
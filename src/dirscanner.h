@@ -0,0 +1,52 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef DIRSCANNER_H
+#define DIRSCANNER_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+// Estimates what a first snapshot of a directory would cost. A few threads walk the tree with
+// getdents64/fstatat (no per-entry allocations beyond the path), stay on one filesystem, skip .git, and stop
+// as soon as the tree is known to be past the limits or the time budget is spent, so the answer is a lower
+// bound for really big trees.
+namespace DirScanner
+{
+struct Limits {
+    qint64 maxFiles {200000};
+    qint64 maxBytes {qint64(20) << 30};
+    int maxMsecs {1500};
+    int threads {4};
+};
+
+struct Result {
+    qint64 files {0};
+    qint64 bytes {0};
+    bool complete {true}; // false if a limit stopped the walk
+    QList<QPair<QString, qint64>> largestDirs; // top level subdirectories by size, largest first
+};
+
+[[nodiscard]] Result scan(const QString &dir, const Limits &limits = {});
+} // namespace DirScanner
+
+#endif // DIRSCANNER_H
@@ -0,0 +1,201 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "elevatedworker.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEventLoop>
+#include <QFile>
+#include <QtEndian>
+
+#include <csignal>
+
+#include "workerprotocol.h"
+
+namespace
+{
+void appendU32(QByteArray &buf, quint32 value)
+{
+    const quint32 be = qToBigEndian(value);
+    buf.append(reinterpret_cast<const char *>(&be), sizeof(be));
+}
+
+void appendBytes(QByteArray &buf, const QByteArray &bytes)
+{
+    appendU32(buf, static_cast<quint32>(bytes.size()));
+    buf.append(bytes);
+}
+
+quint32 readU32(const QByteArray &buf, qsizetype pos)
+{
+    return qFromBigEndian<quint32>(buf.constData() + pos);
+}
+
+QString workerPath()
+{
+    return QString("/usr/lib/%1/%1-worker").arg(QCoreApplication::applicationName());
+}
+} // namespace
+
+ElevatedWorker::ElevatedWorker(QObject *parent)
+    : QObject(parent)
+{
+    // The worker's commands inherit its signal mask, none of this process' blocked signals
+    proc.setChildProcessModifier([] {
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+    });
+}
+
+ElevatedWorker::~ElevatedWorker()
+{
+    if (proc.state() != QProcess::NotRunning) {
+        // Closing stdin is the shutdown request
+        proc.closeWriteChannel();
+        if (!proc.waitForFinished(1000)) {
+            proc.kill();
+            proc.waitForFinished(1000);
+        }
+    }
+}
+
+ElevatedWorker &ElevatedWorker::instance()
+{
+    // Parented to the application so the worker is shut down before the event loop goes away
+    static auto *worker = new ElevatedWorker(QCoreApplication::instance());
+    return *worker;
+}
+
+bool ElevatedWorker::isInstalled()
+{
+    return QFile::exists(workerPath());
+}
+
+bool ElevatedWorker::ensureStarted()
+{
+    if (proc.state() == QProcess::Running) {
+        return true;
+    }
+    buffer.clear();
+    responses.clear();
+    ++starts;
+    const QString asRoot = QFile::exists("/usr/bin/pkexec") ? "/usr/bin/pkexec" : "/usr/bin/gksu";
+    const QString helper = QString("/usr/lib/%1/helper").arg(QCoreApplication::applicationName());
+    qDebug() << "Starting elevated worker";
+    proc.start(asRoot, {helper, "--worker"});
+    return proc.waitForStarted();
+}
+
+bool ElevatedWorker::exec(const QStringList &argv, const QString &cwd, const QByteArray &input, Result *result)
+{
+    if (argv.isEmpty() || !ensureStarted()) {
+        return false;
+    }
+
+    const quint32 id = nextId++;
+    const int worker = starts;
+    QByteArray payload;
+    appendU32(payload, id);
+    appendU32(payload, static_cast<quint32>(argv.size()));
+    for (const QString &arg : argv) {
+        appendBytes(payload, arg.toUtf8());
+    }
+    appendBytes(payload, cwd.toUtf8());
+    appendBytes(payload, input);
+
+    QByteArray frame;
+    frame.reserve(payload.size() + 4);
+    appendU32(frame, static_cast<quint32>(payload.size()));
+    frame.append(payload);
+    proc.write(frame);
+
+    // Another call may be made from this loop; its answer is kept for it and this one waits for its own id
+    QEventLoop loop;
+    connect(&proc, &QProcess::readyReadStandardOutput, &loop, &QEventLoop::quit);
+    connect(this, &ElevatedWorker::responseRead, &loop, &QEventLoop::quit);
+    connect(&proc, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), &loop, &QEventLoop::quit);
+    while (true) {
+        readResponses();
+        if (responses.contains(id)) {
+            *result = responses.take(id);
+            return true;
+        }
+        if (proc.state() == QProcess::NotRunning || starts != worker) {
+            // Authentication was dismissed or the worker died, report pkexec's exit code
+            result->exitCode = proc.exitCode();
+            result->out.clear();
+            result->err = proc.readAllStandardError();
+            return false;
+        }
+        loop.exec();
+    }
+}
+
+// A frame that doesn't add up leaves no way to find the next one; the worker is stopped, the calls waiting on
+// it fail and the next call starts a new one
+void ElevatedWorker::resync()
+{
+    qWarning() << "Malformed response from the elevated worker, restarting it";
+    buffer.clear();
+    proc.kill();
+}
+
+void ElevatedWorker::readResponses()
+{
+    buffer.append(proc.readAllStandardOutput());
+    while (buffer.size() >= 4) {
+        const qsizetype frameLen = readU32(buffer, 0);
+        if (frameLen < 16 || frameLen > WorkerProtocol::MaxFrameSize) {
+            resync();
+            return;
+        }
+        if (buffer.size() < frameLen + 4) {
+            return;
+        }
+        qsizetype pos = 4;
+        const quint32 id = readU32(buffer, pos);
+        pos += 4;
+        Result result;
+        result.exitCode = static_cast<int>(readU32(buffer, pos));
+        pos += 4;
+        const qsizetype outLen = readU32(buffer, pos);
+        pos += 4;
+        if (outLen > frameLen - 16) {
+            resync();
+            return;
+        }
+        result.out = buffer.mid(pos, outLen);
+        pos += outLen;
+        const qsizetype errLen = readU32(buffer, pos);
+        pos += 4;
+        if (outLen + errLen != frameLen - 16) {
+            resync();
+            return;
+        }
+        result.err = buffer.mid(pos, errLen);
+        buffer.remove(0, frameLen + 4);
+        responses.insert(id, result);
+        // Wakes the waiting calls further up the stack as well, the data is gone from the pipe
+        emit responseRead();
+    }
+}
@@ -0,0 +1,64 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef ELEVATEDWORKER_H
+#define ELEVATEDWORKER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QProcess>
+#include <QStringList>
+
+// Client side of the persistent root worker. The worker is started through pkexec on first use
+// and then serves every elevated command of the session over its stdin/stdout pipe.
+class ElevatedWorker : public QObject
+{
+    Q_OBJECT
+public:
+    struct Result {
+        int exitCode {-1};
+        QByteArray out;
+        QByteArray err;
+    };
+
+    static ElevatedWorker &instance();
+    [[nodiscard]] static bool isInstalled();
+    bool exec(const QStringList &argv, const QString &cwd, const QByteArray &input, Result *result);
+
+signals:
+    void responseRead();
+
+private:
+    explicit ElevatedWorker(QObject *parent = nullptr);
+    ~ElevatedWorker() override;
+    bool ensureStarted();
+    void readResponses();
+    void resync();
+
+    QProcess proc;
+    QByteArray buffer;
+    // Answers by request id, for calls waiting further up the stack
+    QHash<quint32, Result> responses;
+    quint32 nextId {1};
+    int starts {0}; // a call made before a restart gets no answer from the new worker
+};
+
+#endif // ELEVATEDWORKER_H
@@ -0,0 +1,109 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "filehistorydialog.h"
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "diffdialog.h"
+#include "git.h"
+
+namespace
+{
+enum Column { CommitColumn, AgeColumn, LinesColumn, MessageColumn };
+} // namespace
+
+FileHistoryDialog::FileHistoryDialog(Git *git, const QString &path, QWidget *parent)
+    : QDialog(parent),
+      git(git),
+      path(path),
+      tree(new QTreeWidget(this)),
+      summary(new QLabel(tr("Loading..."), this))
+{
+    setWindowTitle(tr("History of %1").arg(path));
+    tree->setRootIsDecorated(false);
+    tree->setUniformRowHeights(true);
+    tree->setHeaderLabels({tr("Checkpoint"), tr("Date"), tr("Lines"), tr("Description")});
+    tree->header()->setStretchLastSection(true);
+    connect(tree, &QTreeWidget::itemDoubleClicked, this, &FileHistoryDialog::showDiff);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(tree);
+    layout->addWidget(summary);
+    resize(700, 450);
+
+    job = git->fileHistoryAsync(path, this, [this](bool ok, const QList<FileHistoryEntry> &entries) {
+        job = 0;
+        setEntries(ok, entries);
+    });
+}
+
+FileHistoryDialog::~FileHistoryDialog()
+{
+    if (job != 0) {
+        git->cancelJob(job);
+    }
+}
+
+void FileHistoryDialog::setEntries(bool ok, const QList<FileHistoryEntry> &entries)
+{
+    if (!ok) {
+        summary->setText(tr("Could not read the history of %1").arg(path));
+        return;
+    }
+    QList<QTreeWidgetItem *> items;
+    items.reserve(entries.size());
+    const QLocale locale;
+    for (const FileHistoryEntry &entry : entries) {
+        QString lines = QString("+%1 -%2").arg(locale.toString(entry.added), locale.toString(entry.deleted));
+        if (entry.binary) {
+            lines = (entry.added == 0 && entry.deleted == 0) ? tr("binary") : lines + ' ' + tr("and binary");
+        }
+        auto *item = new QTreeWidgetItem({entry.commit, entry.age, lines, entry.message});
+        item->setToolTip(AgeColumn, entry.date);
+        items.append(item);
+    }
+    tree->addTopLevelItems(items);
+    for (const int column : {CommitColumn, AgeColumn, LinesColumn}) {
+        tree->resizeColumnToContents(column);
+    }
+    summary->setText(entries.isEmpty() ? tr("No checkpoint changed %1").arg(path)
+                                       : tr("%n checkpoint(s), double-click one to compare it with the current "
+                                            "version",
+                                            nullptr, static_cast<int>(entries.size())));
+}
+
+void FileHistoryDialog::showDiff(QTreeWidgetItem *item)
+{
+    const QString commit = item->text(CommitColumn);
+    DiffDialog dialog(this);
+    dialog.setWindowTitle(tr("Current .. %1").arg(commit) + "  " + path);
+    const quint64 diffJob = git->diffAsync(
+        commit, {path}, &dialog, [&dialog](const QByteArray &chunk) { dialog.appendOutput(chunk); },
+        [&dialog](bool ok, const QString &error) { dialog.finish(ok, error); }, dialog.fileLimit());
+    dialog.exec();
+    git->cancelJob(diffJob);
+}
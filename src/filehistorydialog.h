@@ -0,0 +1,53 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef FILEHISTORYDIALOG_H
+#define FILEHISTORYDIALOG_H
+
+#include <QDialog>
+
+class Git;
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+struct FileHistoryEntry;
+
+// Checkpoints that changed one file (or directory), with the lines added and deleted in each.
+// Double-clicking a checkpoint shows the diff from it to the current version.
+class FileHistoryDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    FileHistoryDialog(Git *git, const QString &path, QWidget *parent = nullptr);
+    ~FileHistoryDialog() override;
+
+private:
+    Git *git;
+    QString path;
+    QTreeWidget *tree;
+    QLabel *summary;
+    quint64 job {0};
+
+    void setEntries(bool ok, const QList<FileHistoryEntry> &entries);
+    void showDiff(QTreeWidgetItem *item);
+};
+
+#endif // FILEHISTORYDIALOG_H
@@ -21,51 +21,158 @@
  **********************************************************************/
 #include "git.h"
 
-#include <QApplication>
+#include <QCoreApplication>
 #include <QDateTime>
+#include <QDebug>
 #include <QDir>
-#include <QMessageBox>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QtEndian>
+
+#include <algorithm>
+#include <memory>
+#include <unistd.h>
+
+#include "chunkstore.h"
+
+namespace
+{
+const QString LargeProfileKey = QStringLiteral("restore-gui.profile");
+const QString RetentionKey = QStringLiteral("restore-gui.retention");
+const QString LastRetentionKey = QStringLiteral("restore-gui.lastretention");
+const QString ChunkThresholdKey = QStringLiteral("restore-gui.chunkthreshold");
+
+// restore-cli next to this program (a build directory), else the installed one
+QString chunkFilterCommand(const QString &command)
+{
+    const QString local = QCoreApplication::applicationDirPath() + "/restore-cli";
+    const QString cli = QFileInfo(local).isExecutable() ? local : QStringLiteral("/usr/bin/restore-cli");
+    return QString("'%1' %2").arg(cli, command);
+}
+
+// One entry of the first-parent chain, with everything commit-tree needs to write it again
+struct ChainCommit {
+    QString hash;
+    QString tree;
+    QStringList environment; // GIT_AUTHOR_* and GIT_COMMITTER_*
+    QByteArray message;
+    qint64 time {0};
+};
+
+QList<ChainCommit> parseChain(const QByteArray &out)
+{
+    QList<ChainCommit> chain;
+    for (const QByteArray &record : out.split('\0')) {
+        const QList<QByteArray> fields = record.split('\x1f');
+        if (fields.size() != 9) {
+            continue;
+        }
+        const auto field = [&fields](int i) { return QString::fromUtf8(fields.at(i)); };
+        chain.append({field(0).trimmed(),
+                      field(1),
+                      {"GIT_AUTHOR_NAME=" + field(2), "GIT_AUTHOR_EMAIL=" + field(3), "GIT_AUTHOR_DATE=" + field(4),
+                       "GIT_COMMITTER_NAME=" + field(5), "GIT_COMMITTER_EMAIL=" + field(6),
+                       "GIT_COMMITTER_DATE=" + field(7)},
+                      fields.at(8),
+                      fields.at(7).split(' ').constFirst().toLongLong()});
+    }
+    return chain;
+}
+} // namespace
 
 Git::Git(QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      backend(GitBackend::create(GitBackend::preferred())),
+      cliBackend(GitBackend::create(QStringLiteral("cli")))
 {
-    // Set busy cursor during git operations
-    connect(&cmd, &Cmd::started, [] { QApplication::setOverrideCursor(QCursor(Qt::BusyCursor)); });
-    connect(&cmd, &Cmd::done, [] { QApplication::setOverrideCursor(QCursor(Qt::ArrowCursor)); });
+    qDebug() << "Git backend:" << backend->name();
+    connect(&cache, &RepoCache::headChanged, this, &Git::repositoryChanged);
+    connect(&cmd, &Cmd::started, this, &Git::commandStarted);
+    connect(&cmd, &Cmd::done, this, &Git::commandFinished);
 }
 
-void Git::add(const QStringList &files)
+QString Git::backendName() const
 {
-    // Handle both single file and multiple files cases
-    const QString command = (files.size() == 1 && files.at(0) == ".") ? "git add ." : "git add " + files.join(' ');
-    cmd.run(command, nullptr, nullptr, false, needElevation());
+    return backend->name();
 }
 
-void Git::commit(const QStringList &files, const QString &message)
+void Git::add(const QStringList &files)
 {
-    const QString addList = files.isEmpty() ? "." : files.join(' ');
+    if (files.isEmpty() || (files.size() == 1 && files.at(0) == ".")) {
+        runGit({"add", "."});
+        return;
+    }
+    addPaths(files);
+}
 
-    if (!isInitialized()) {
-        // Warn user before initializing git in large directories
-        if (isLargeDirectory()
-            && QMessageBox::No
-                   == QMessageBox::question(nullptr, tr("Confirmation"),
-                                            tr("You are trying to snapshot a large folder, are you sure? If you select "
-                                               "'Yes' it might take a long time to process."))) {
-            return;
+// Initializes the repository on the first snapshot, with the given profile; expectedFiles (e.g. from DirScanner)
+// is only used for progress when the last worktree scan can't tell
+bool Git::commit(const QStringList &files, const QString &message, qint64 expectedFiles, Profile profile)
+{
+    const DirPin pin(this);
+    qint64 totalFiles = files.isEmpty() ? expectedFiles : files.size();
+    bool writeGraph = false;
+    if (!isInitialized(currentDir())) {
+        if (!initialize()) {
+            return false;
         }
-        // Initialize repository and make first commit
-        cmd.run("git init && git add " + addList + " && git commit -m '" + message + "'", nullptr, nullptr, false,
-                needElevation());
-    } else {
-        // Regular commit
-        cmd.run("git add " + addList + " && git commit -m '" + message + "'", nullptr, nullptr, false, needElevation());
+        if (profile == Profile::LargeDirectory) {
+            writeGraph = writeLargeProfile();
+        }
+    } else if (files.isEmpty()) {
+        if (const auto worktree = cache.worktree(currentDir())) {
+            totalFiles = worktree->tracked.size() + worktree->untracked.size();
+        }
+    }
+
+    beginOperation();
+    const QString phase = tr("Adding files");
+    const bool added = markLargeFiles(files)
+                       && (files.isEmpty() ? runStep(phase, totalFiles, {"add", "--verbose", "."})
+                                           : addPaths(files, phase, totalFiles));
+    const bool ok = added && runStep(tr("Writing checkpoint"), 0, {"commit", "-F", "-"}, message.toUtf8());
+    if (ok && writeGraph) {
+        runStep(tr("Writing commit graph"), 0, {"commit-graph", "write", "--reachable", "--changed-paths"});
     }
+    endOperation();
+    return ok;
+}
+
+// Switch an existing checkpoint repository to the large directory profile and convert its index now
+// instead of on the next snapshot. Status is timed before and after (the second run after, the first one
+// fills the untracked cache and starts the fsmonitor daemon).
+ProfileReport Git::applyLargeProfile()
+{
+    const DirPin pin(this);
+    ProfileReport report;
+    if (!isInitialized(currentDir())) {
+        return report;
+    }
+    report.statusBeforeMs = timeStatus();
+    beginOperation();
+    const QString phase = tr("Optimizing for large folders");
+    QStringList updateIndex {"update-index", "--index-version", "4", "--split-index", "--untracked-cache"};
+    report.fsmonitor = fsmonitorAvailable();
+    if (report.fsmonitor) {
+        updateIndex << "--fsmonitor";
+    }
+    report.ok = writeLargeProfile() && runStep(phase, 0, updateIndex)
+                && runStep(tr("Writing commit graph"), 0, {"commit-graph", "write", "--reachable", "--changed-paths"});
+    endOperation();
+    if (report.ok) {
+        timeStatus();
+        report.statusAfterMs = timeStatus();
+    }
+    return report;
 }
 
 void Git::popStash()
 {
-    cmd.run("git stash pop", nullptr, nullptr, false, needElevation());
+    runGit({"stash", "pop"});
 }
 
 void Git::rebaseToPrevious(const QString &commit)
@@ -73,15 +180,22 @@ void Git::rebaseToPrevious(const QString &commit)
     if (commit.isEmpty()) {
         return;
     }
-    const QString command = QString("git rebase --onto $(git rev-parse %1^) %1").arg(commit);
-    cmd.run(command, nullptr, nullptr, false, needElevation());
+    runGit({"rebase", "--onto", commit + '^', commit});
 }
 
-void Git::stash(const QStringList &files)
+bool Git::stash(const QStringList &files)
 {
-    const QString command
-        = files.isEmpty() ? "git stash" : "git stash push " + files.join(' ') + " -m 'stash created by GUI program'";
-    cmd.run(command, nullptr, nullptr, false, needElevation());
+    const DirPin pin(this);
+    beginOperation();
+    const bool ok
+        = files.isEmpty()
+              ? runStep(tr("Stashing changes"), 0, {"stash"})
+              : runStep(tr("Stashing changes"), 0,
+                        {"stash", "push", "-m", "stash created by GUI program", "--pathspec-from-file=-",
+                         "--pathspec-file-nul"},
+                        pathspecInput(files));
+    endOperation();
+    return ok;
 }
 
 // Stash, branch, and reset
@@ -91,105 +205,900 @@ QString Git::resetToCommit(const QString &commit)
     if (commit.isEmpty()) {
         return {};
     }
-    cmd.run("git stash && git branch " + name + " && git reset --hard " + commit, nullptr, nullptr, false,
-            needElevation());
-    return name;
+    const DirPin pin(this);
+    beginOperation();
+    const bool ok = runStep(tr("Stashing changes"), 0, {"stash"})
+                    && runStep(tr("Backing up checkpoints"), 0, {"branch", name})
+                    && runStep(tr("Restoring files"), 0, {"reset", "--hard", commit});
+    endOperation();
+    return ok ? name : QString();
 }
 
 // Stash and revert
-void Git::revertFiles(const QString &commit, const QStringList &files)
+bool Git::revertFiles(const QString &commit, const QStringList &files)
 {
     if (files.isEmpty() || commit.isEmpty()) {
-        return;
+        return false;
+    }
+    const DirPin pin(this);
+    beginOperation();
+    const bool ok
+        = runStep(tr("Stashing changes"), 0, {"stash"})
+          && runStep(tr("Restoring files"), files.size(),
+                     {"checkout", "--progress", commit, "--pathspec-from-file=-", "--pathspec-file-nul"},
+                     pathspecInput(files))
+          && runStep(tr("Writing checkpoint"), 0, {"commit", "-F", "-"},
+                     ("Restored files: " + files.join(' ')).toUtf8());
+    endOperation();
+    return ok;
+}
+
+// Size in MiB from which files go to the chunk store, 0 if it isn't used
+qint64 Git::chunkThreshold()
+{
+    return configValue(ChunkThresholdKey).toLongLong();
+}
+
+// The filter is registered in the repository itself, git runs it for add, status, checkout and reset
+bool Git::setChunkThreshold(qint64 mib)
+{
+    const DirPin pin(this);
+    if (!isInitialized(currentDir()) && !initialize()) {
+        return false;
+    }
+    const QString filter = QString("filter.%1.").arg(QLatin1String(ChunkStore::FilterName));
+    chunkedDirs.remove(currentDir());
+    return runGit({"config", filter + "clean", chunkFilterCommand("chunk-clean")})
+           && runGit({"config", filter + "smudge", chunkFilterCommand("chunk-smudge")})
+           && runGit({"config", filter + "required", "true"})
+           && runGit({"config", ChunkThresholdKey, QString::number(std::max<qint64>(mib, 0))});
+}
+
+// Route new or modified files at or above the chunk threshold through the chunk store filter, with one line
+// each in .git/info/attributes. Files stay marked when they shrink, the pointer then just lists fewer chunks.
+bool Git::markLargeFiles(const QStringList &files)
+{
+    const qint64 threshold = chunkThreshold() * 1024 * 1024;
+    if (threshold <= 0) {
+        return true;
+    }
+    const QList<JobResult> results
+        = wait({{"git", {"rev-parse", "--show-toplevel", "--absolute-git-dir"}, {}},
+                {"git", {"ls-files", "-z", "--full-name", "--modified", "--others", "--exclude-standard"}, {}}});
+    const QStringList dirs = QString::fromUtf8(results.at(0).out).split('\n', Qt::SkipEmptyParts);
+    if (!results.at(0).ok() || !results.at(1).ok() || dirs.size() != 2) {
+        return false;
+    }
+    const QDir top(dirs.at(0));
+    // Relative selections are relative to the operation's directory, not the process's
+    const QDir base(currentDir());
+    QStringList selected;
+    for (const QString &file : files) {
+        selected.append(QDir::cleanPath(base.absoluteFilePath(file)));
+    }
+    QFile attributes(QDir(dirs.at(1)).absoluteFilePath("info/attributes"));
+    QByteArray existing;
+    if (attributes.open(QIODevice::ReadOnly)) {
+        existing = attributes.readAll();
+    }
+    QByteArray lines;
+    for (const QByteArray &name : results.at(1).out.split('\0')) {
+        const QString path = QString::fromUtf8(name);
+        const QFileInfo info(top.filePath(path));
+        if (path.isEmpty() || path.contains('\n') || !info.isFile() || info.size() < threshold) {
+            continue;
+        }
+        const QString absolute = info.absoluteFilePath();
+        if (!selected.isEmpty() && std::none_of(selected.cbegin(), selected.cend(), [&absolute](const QString &dir) {
+                return absolute == dir || absolute.startsWith(dir + '/');
+            })) {
+            continue;
+        }
+        const QByteArray line = ChunkStore::attributeLine(path).toUtf8() + '\n';
+        if (!existing.contains(line) && !lines.contains(line)) {
+            lines += line;
+        }
+    }
+    if (lines.isEmpty()) {
+        return true;
+    }
+    qDebug() << "Chunking" << lines.count('\n') << "large files";
+    return cmd.proc("tee", {"-a", attributes.fileName()}, nullptr, &lines, true, needElevation(currentDir()));
+}
+
+bool Git::retentionEnabled()
+{
+    return configValue(RetentionKey) == "true";
+}
+
+void Git::setRetentionEnabled(bool enabled)
+{
+    runGit({"config", RetentionKey, enabled ? "true" : "false"});
+}
+
+// Thinning is cheap to decide but rewrites the chain and repacks when it drops anything, once a day is enough
+bool Git::applyRetentionIfDue()
+{
+    const DirPin pin(this);
+    if (!retentionEnabled()) {
+        return false;
+    }
+    const qint64 lastRun = configValue(LastRetentionKey).toLongLong();
+    if (QDateTime::currentSecsSinceEpoch() - lastRun < 24 * 3600) {
+        return false;
+    }
+    return applyRetention().ok;
+}
+
+// Drop the checkpoints the policy doesn't keep by writing the kept ones again with commit-tree over their
+// existing trees, parent to parent, and moving the branch in one ref transaction together with deleting
+// backup branches older than the daily tier. The working tree and the index are not touched (the newest
+// checkpoint, and so HEAD's tree, is always kept). Reflog entries of the dropped chain are expired and the
+// objects pruned now rather than at the next gc, except loose objects of the last hour which a snapshot
+// running meanwhile (cron, restore-cli) may not have referenced yet.
+RetentionReport Git::applyRetention(const Retention::Policy &policy)
+{
+    const DirPin pin(this);
+    RetentionReport report;
+    const QString branch = getCurrentBranch();
+    if (branch.isEmpty()) {
+        return report;
+    }
+    const QList<JobResult> results = wait(
+        {{"git",
+          {"log", "--first-parent", "-z", "--date=raw",
+           "--format=%H%x1f%T%x1f%an%x1f%ae%x1f%ad%x1f%cn%x1f%ce%x1f%cd%x1f%B"},
+          {}},
+         {"git", {"for-each-ref", "--format=%(refname)", "refs/heads/bak_*"}, {}}});
+    if (!results.at(0).ok()) {
+        return report;
+    }
+    const QList<ChainCommit> chain = parseChain(results.at(0).out);
+    QList<qint64> times;
+    times.reserve(chain.size());
+    for (const ChainCommit &commit : chain) {
+        times.append(commit.time);
+    }
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const std::vector<bool> keep = Retention::select(times, now, policy);
+    report.before = chain.size();
+    report.after = std::count(keep.cbegin(), keep.cend(), true);
+
+    // Backups are aged by the time in their bak_yyyyMMdd_HHmmss name, when they were made: their tip is the
+    // old HEAD, which can be far older. Branches not named that way are left alone.
+    QStringList oldBackups;
+    for (const QByteArray &line : results.at(1).out.split('\n')) {
+        const QString ref = QString::fromUtf8(line);
+        const QDateTime made = QDateTime::fromString(ref.section("/bak_", -1), QStringLiteral("yyyyMMdd_HHmmss"));
+        if (made.isValid() && now - made.toSecsSinceEpoch() >= policy.dailyDays * 24 * 3600LL) {
+            oldBackups.append(ref);
+        }
+    }
+    report.backupsDeleted = oldBackups.size();
+    if (report.after == report.before && oldBackups.isEmpty()) {
+        report.ok = true;
+        runGit({"config", LastRetentionKey, QString::number(now)});
+        return report;
+    }
+
+    beginOperation();
+    progress.phase = tr("Thinning out checkpoints");
+    progress.totalFiles = report.after;
+    emit operationProgress(progress);
+    // Oldest first; kept checkpoints below the first dropped one keep their hash
+    QString parent;
+    bool rewriting = false;
+    bool ok = true;
+    static const QRegularExpression hashPattern(QStringLiteral("^[0-9a-f]{40,64}$"));
+    for (qsizetype i = chain.size() - 1; i >= 0 && ok && !canceled; --i) {
+        if (!keep.at(i)) {
+            rewriting = true;
+            continue;
+        }
+        const ChainCommit &commit = chain.at(i);
+        ++progress.files;
+        if (!rewriting) {
+            parent = commit.hash;
+            continue;
+        }
+        QStringList args = commit.environment + QStringList {"git", "commit-tree", commit.tree};
+        if (!parent.isEmpty()) {
+            args << "-p" << parent;
+        }
+        args << "-F" << "-";
+        QString output;
+        cmd.setWorkingDirectory(currentDir());
+        ok = cmd.proc("env", args, &output, &commit.message, true, needElevation(currentDir()));
+        parent = output.section('\n', -1).trimmed();
+        ok = ok && hashPattern.match(parent).hasMatch();
+        if (progress.files % 50 == 0) {
+            emit operationProgress(progress);
+        }
+    }
+
+    QByteArray transaction;
+    if (rewriting) {
+        transaction += QString("update refs/heads/%1 %2 %3\n").arg(branch, parent, chain.constFirst().hash).toUtf8();
+    }
+    for (const QString &ref : std::as_const(oldBackups)) {
+        transaction += "delete " + ref.toUtf8() + '\n';
+    }
+    // The old tip as expected value: a snapshot made meanwhile makes the transaction fail instead of being lost
+    ok = ok && !canceled
+         && runStep(tr("Updating checkpoints"), 0, {"update-ref", "-m", "restore-gui retention", "--stdin"}, transaction)
+         && runStep(tr("Removing old checkpoints"), 0,
+                    {"reflog", "expire", "--expire-unreachable=now", "HEAD", "refs/heads/" + branch})
+         && runStep(tr("Removing old checkpoints"), 0, {"gc", "--quiet", "--prune=1.hour.ago"});
+    endOperation();
+    if (ok) {
+        runGit({"config", LastRetentionKey, QString::number(now)});
     }
-    QString command = "git stash && git checkout " + commit + " -- " + files.join(' ')
-                      + " && git commit -m 'Restored files: " + files.join(' ') + "'";
-    cmd.run(command, nullptr, nullptr, false, needElevation());
+    report.ok = ok;
+    return report;
 }
 
 void Git::setEmailGit(const QString &email)
 {
-    cmd.run("git config --global user.email '" + email + "'");
+    cmd.proc("git", {"config", "--global", "user.email", email});
 }
 
 void Git::setUserGit(const QString &name)
 {
-    cmd.run("git config --global user.name '" + name + "'");
+    cmd.proc("git", {"config", "--global", "user.name", name});
 }
 
 QString Git::createBackupBranch()
 {
     const QString name = "bak_" + QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss"));
-    cmd.run("git branch " + name, nullptr, nullptr, false, needElevation());
+    runGit({"branch", name});
     return name;
 }
 
 QString Git::getEmailGit()
 {
-    return cmd.getOut("git config --global --get user.email 2>/dev/null", true);
+    return QString::fromUtf8(wait({backend->configCommand("user.email")}).constFirst().out).trimmed();
 }
 
 QString Git::getUserGit()
 {
-    return cmd.getOut("git config --global --get user.name 2>/dev/null", true);
+    return QString::fromUtf8(wait({backend->configCommand("user.name")}).constFirst().out).trimmed();
 }
 
 QStringList Git::getStatus(const QString &commit)
 {
-    // Get modified, added, deleted files from git diff
-    QStringList status = cmd.getOut("git diff --name-status " + commit + " 2>/dev/null", true).split('\n');
+    const WorktreeStatus worktree = StatusEngine::parseScan(wait({statusCommand()}).constFirst());
+    if (!worktree.isRepo || worktree.isHead(commit)) {
+        return StatusEngine::changesSince(worktree, {}).toLines();
+    }
+    const JobResult treeDiff = wait({readBackend().treeDiffCommand(commit)}).constFirst();
+    return StatusEngine::changesSince(worktree, StatusEngine::parseTreeDiff(treeDiff.out)).toLines();
+}
+
+QStringList Git::listCommits(int count)
+{
+    return parseCommits(wait({backend->logCommand(0, count)}));
+}
+
+bool Git::hasModifiedFiles()
+{
+    return StatusEngine::parseScan(wait({statusCommand()}).constFirst()).hasModifications();
+}
 
-    // Get untracked files
-    QStringList untracked = cmd.getOut("git ls-files --others --exclude-standard 2>/dev/null", true).split('\n');
+// Cached per directory, the setting only changes through applyLargeProfile
+bool Git::hasLargeProfile()
+{
+    const QString dir = currentDir();
+    if (const auto it = largeProfileDirs.constFind(dir); it != largeProfileDirs.cend()) {
+        return *it;
+    }
+    const bool large = configValue(LargeProfileKey) == "large";
+    largeProfileDirs.insert(dir, large);
+    return large;
+}
 
-    // Add untracked files with "??" status prefix (same as git status)
-    for (const QString &file : untracked) {
-        if (!file.isEmpty()) {
-            status.append("??\t" + file);
+// The diff text is handed over in chunks as git writes it, done() follows with the outcome. Always through git,
+// libgit2 builds the whole patch in memory before anything can be shown. With a limit, the changed files are
+// sized first from "diff --raw" (blobs through cat-file, working tree files from the file system) and a file
+// over it gets a one line summary instead of being read at all.
+quint64 Git::diffAsync(const QString &commit, const QStringList &files, QObject *context,
+                       const std::function<void(const QByteArray &)> &output,
+                       const std::function<void(bool, const QString &)> &done, qint64 maxFileBytes)
+{
+    const QString dir = QDir::currentPath();
+    QStringList pathspec;
+    for (const QString &file : files) {
+        pathspec.append(":(literal)" + file);
+    }
+    if (maxFileBytes <= 0) {
+        return streamDiff(dir, commit, pathspec, context, output, done);
+    }
+    const JobCommand top {"git", {"rev-parse", "--show-toplevel"}, {}};
+    const JobCommand raw {
+        "git", QStringList {"diff", "--raw", "-z", "--no-abbrev", "--no-renames", commit, "--"} + pathspec, {}};
+    auto chain = std::make_shared<quint64>(0);
+    *chain = jobs.enqueue(
+        dir, QStringLiteral("diff"), JobQueue::Priority::High, {top, raw}, context,
+        [=, this](const QList<JobResult> &results) {
+            if (!results.at(0).ok() || !results.at(1).ok()) {
+                jobChains.remove(*chain);
+                done(false, QString::fromUtf8(results.at(0).err + results.at(1).err));
+                return;
+            }
+            const QDir topDir(QString::fromUtf8(results.at(0).out).trimmed());
+            const QList<RawChange> changes = parseRawDiff(results.at(1).out);
+            QByteArray oids;
+            for (const RawChange &change : changes) {
+                for (const QByteArray &oid : {change.oldOid, change.newOid}) {
+                    if (!isNullOid(oid)) {
+                        oids += oid + '\n';
+                    }
+                }
+            }
+            const auto sized = [=, this](const QHash<QByteArray, qint64> &blobSizes) {
+                QStringList excluded = pathspec;
+                QByteArray summaries;
+                for (const RawChange &change : changes) {
+                    const qint64 newSize = !isNullOid(change.newOid) ? blobSizes.value(change.newOid)
+                                           : change.status == 'D' ? 0
+                                                                  : QFileInfo(topDir.filePath(change.path)).size();
+                    const qint64 size = std::max(blobSizes.value(change.oldOid), newSize);
+                    if (size > maxFileBytes) {
+                        excluded.append(":(top,exclude,literal)" + change.path);
+                        summaries += "diff --git a/" + change.path.toUtf8() + " b/" + change.path.toUtf8() + '\n'
+                                     + tr("[Not shown, this file is %1 KiB, over the %2 KiB limit for diffs]")
+                                           .arg(size / 1024)
+                                           .arg(maxFileBytes / 1024)
+                                           .toUtf8()
+                                     + '\n';
+                    }
+                }
+                if (!summaries.isEmpty()) {
+                    output(summaries);
+                }
+                // Nothing left to read (and a pathspec of only excludes would mean everything else)
+                if (excluded.size() - pathspec.size() == changes.size()) {
+                    jobChains.remove(*chain);
+                    done(true, {});
+                    return;
+                }
+                jobChains.insert(*chain, streamDiff(dir, commit, excluded, context, output,
+                                                    [this, chain, done](bool ok, const QString &error) {
+                                                        jobChains.remove(*chain);
+                                                        done(ok, error);
+                                                    }));
+            };
+            if (oids.isEmpty()) {
+                sized({});
+                return;
+            }
+            const JobCommand sizes {"git", {"cat-file", "--batch-check=%(objectname) %(objectsize)"}, oids};
+            const auto parseSizes = [sized](const QList<JobResult> &results) {
+                QHash<QByteArray, qint64> blobSizes;
+                for (const QByteArray &line : results.constFirst().out.split('\n')) {
+                    const qsizetype space = line.indexOf(' ');
+                    if (space > 0) {
+                        blobSizes.insert(line.left(space), line.mid(space + 1).toLongLong());
+                    }
+                }
+                sized(blobSizes);
+            };
+            jobChains.insert(*chain, jobs.enqueue(dir, QStringLiteral("diff"), JobQueue::Priority::High, {sizes},
+                                                  context, parseSizes));
+        });
+    return *chain;
+}
+
+quint64 Git::streamDiff(const QString &dir, const QString &commit, const QStringList &pathspec, QObject *context,
+                        const std::function<void(const QByteArray &)> &output,
+                        const std::function<void(bool, const QString &)> &done)
+{
+    JobCommand command = cliBackend->diffCommand(commit, pathspec);
+    command.output = output;
+    return jobs.enqueue(dir, QStringLiteral("diff"), JobQueue::Priority::High, {command}, context,
+                        [done](const QList<JobResult> &results) {
+                            const JobResult &result = results.constFirst();
+                            done(result.ok(), QString::fromUtf8(result.err));
+                        });
+}
+
+// ":<old mode> <new mode> <old oid> <new oid> <status>\0<path>\0" per change, a null new oid for files that
+// differ from the index
+QList<Git::RawChange> Git::parseRawDiff(const QByteArray &out)
+{
+    QList<RawChange> changes;
+    const QList<QByteArray> tokens = out.split('\0');
+    for (qsizetype i = 0; i + 1 < tokens.size(); i += 2) {
+        const QList<QByteArray> fields = tokens.at(i).split(' ');
+        if (fields.size() < 5 || fields.at(4).isEmpty()) {
+            break;
         }
+        changes.append({fields.at(2), fields.at(3), fields.at(4).at(0), QString::fromUtf8(tokens.at(i + 1))});
+    }
+    return changes;
+}
+
+bool Git::isNullOid(const QByteArray &oid)
+{
+    return oid.isEmpty() || oid.count('0') == oid.size();
+}
+
+// Checkpoints that changed path, newest first. git log skips the trees of commits that can't have touched the
+// path using the changed-path Bloom filters of the commit-graph, so the first run writes one if the repository
+// has none yet; background maintenance extends it as checkpoints are added.
+quint64 Git::fileHistoryAsync(const QString &path, QObject *context,
+                              const std::function<void(bool, const QList<FileHistoryEntry> &)> &callback)
+{
+    const QString dir = QDir::currentPath();
+    const QString objects = RepoCache::findGitDir(dir) + "/objects/info/";
+    QList<JobCommand> commands;
+    if (!QFileInfo::exists(objects + "commit-graph") && !QFileInfo::exists(objects + "commit-graphs")) {
+        commands.append({"git", {"commit-graph", "write", "--reachable", "--split", "--changed-paths"}, {}});
     }
+    commands.append({"git",
+                     {"--literal-pathspecs", "log", "--no-renames", "--numstat",
+                      "--format=%x1e%h%x1f%cr%x1f%ci%x1f%s", "--", path},
+                     {}});
+    return jobs.enqueue(dir, QStringLiteral("history"), JobQueue::Priority::High, commands, context,
+                        [callback](const QList<JobResult> &results) {
+                            const JobResult &log = results.constLast();
+                            callback(log.ok(), parseFileHistory(log.out));
+                        });
+}
 
-    return status;
+// Changes since HEAD come straight from the worktree scan, older checkpoints only add a tree-to-tree diff,
+// which is cached until HEAD moves
+quint64 Git::getStatusAsync(const QString &commit, const WorktreeStatus &worktree, QObject *context,
+                            const std::function<void(const ChangeList &)> &callback)
+{
+    if (!worktree.isRepo || worktree.isHead(commit)) {
+        callback(StatusEngine::changesSince(worktree, {}));
+        return 0;
+    }
+    const QString dir = QDir::currentPath();
+    if (const auto treeChanges = cache.treeDiff(dir, commit)) {
+        callback(StatusEngine::changesSince(worktree, *treeChanges));
+        return 0;
+    }
+    const JobCommand treeDiff = readBackend().treeDiffCommand(commit);
+    return jobs.enqueue(dir, QStringLiteral("status"), JobQueue::Priority::High, {treeDiff}, context,
+                        [this, dir, commit, worktree, callback](const QList<JobResult> &results) {
+                            const ChangeList treeChanges = StatusEngine::parseTreeDiff(results.constFirst().out);
+                            if (results.constFirst().ok()) {
+                                cache.setTreeDiff(dir, commit, treeChanges);
+                            }
+                            callback(StatusEngine::changesSince(worktree, treeChanges));
+                        });
 }
 
-QStringList Git::listCommits()
+// One page of the checkpoint list, newest first
+quint64 Git::listCommitsAsync(int skip, int count, QObject *context,
+                              const std::function<void(bool, const QStringList &)> &callback)
 {
-    if (!isInitialized()) {
+    const QString dir = QDir::currentPath();
+    if (const auto commits = cache.commits(dir, skip, count)) {
+        callback(true, *commits);
+        return 0;
+    }
+    // A failing git log means there is no repository (or no commit yet), no need to ask rev-parse first.
+    // Pages get their own key so fetching the next one doesn't supersede a page still loading.
+    return jobs.enqueue(dir, QStringLiteral("log:%1").arg(skip), JobQueue::Priority::Normal,
+                        {backend->logCommand(skip, count)}, context,
+                        [this, dir, skip, count, callback](const QList<JobResult> &results) {
+                            const QStringList commits = parseCommits(results);
+                            const bool ok = results.constFirst().ok();
+                            if (ok) {
+                                cache.setCommits(dir, skip, count, commits);
+                            }
+                            callback(ok, commits);
+                        });
+}
+
+quint64 Git::scanWorktreeAsync(QObject *context, const std::function<void(const WorktreeStatus &)> &callback)
+{
+    // Always rescanned: edits to tracked files don't touch anything in .git
+    const QString dir = QDir::currentPath();
+    return jobs.enqueue(dir, QStringLiteral("scan"), JobQueue::Priority::Normal, {statusCommand()}, context,
+                        [this, dir, callback](const QList<JobResult> &results) {
+                            const WorktreeStatus worktree = StatusEngine::parseScan(results.constFirst());
+                            cache.setWorktree(dir, worktree);
+                            callback(worktree);
+                        });
+}
+
+// Last scan of the current directory while the index is unchanged, may miss edits made since
+std::optional<WorktreeStatus> Git::cachedWorktree()
+{
+    return cache.worktree(QDir::currentPath());
+}
+
+// Fill the cache for directories the user is likely to open next: the first commits page and a worktree
+// scan, at low priority and only where nothing is cached yet. Navigating cancels whatever hasn't run.
+void Git::prefetch(const QStringList &dirs, int commits)
+{
+    for (const QString &dir : dirs) {
+        if (dir == QDir::currentPath() || RepoCache::findGitDir(dir).isEmpty()) {
+            continue;
+        }
+        if (!cache.commits(dir, 0, commits)) {
+            jobs.enqueue(dir, QStringLiteral("log:0"), JobQueue::Priority::Low, {backend->logCommand(0, commits)},
+                         this, [this, dir, commits](const QList<JobResult> &results) {
+                             if (results.constFirst().ok()) {
+                                 cache.setCommits(dir, 0, commits, parseCommits(results));
+                             }
+                         });
+        }
+        // Through git: whether the directory has the large profile isn't known without asking it
+        if (!cache.worktree(dir)) {
+            jobs.enqueue(dir, QStringLiteral("scan"), JobQueue::Priority::Low, {cliBackend->statusCommand()}, this,
+                         [this, dir](const QList<JobResult> &results) {
+                             const WorktreeStatus worktree = StatusEngine::parseScan(results.constFirst());
+                             if (worktree.isRepo) {
+                                 cache.setWorktree(dir, worktree);
+                             }
+                         });
+        }
+    }
+}
+
+// The id of a chained job (diffAsync) stands for whichever of its steps is queued or running
+void Git::cancelJob(quint64 id)
+{
+    const quint64 current = jobChains.take(id);
+    jobs.cancel(current != 0 ? current : id);
+}
+
+// Drop queued and running work for directories the user navigated away from
+void Git::cancelOtherDirectories(const QString &dir)
+{
+    jobs.cancelOtherDirectories(dir);
+}
+
+// Run commands through the job queue and wait for them, for callers that still need a plain return value
+QList<JobResult> Git::wait(const QList<JobCommand> &commands)
+{
+    QList<JobResult> results;
+    QEventLoop loop;
+    jobs.enqueue(currentDir(), QString(), JobQueue::Priority::High, commands, this,
+                 [&results, &loop](const QList<JobResult> &res) {
+                     results = res;
+                     loop.quit();
+                 });
+    if (results.size() < commands.size()) {
+        loop.exec();
+    }
+    return results;
+}
+
+QStringList Git::parseCommits(const QList<JobResult> &results)
+{
+    if (results.isEmpty() || !results.constFirst().ok()) {
         return {};
     }
-    return cmd.getOut("git log --pretty=format:'%h|%cr - %s' 2>/dev/null", true).split('\n');
+    return QString::fromUtf8(results.constFirst().out).split('\n', Qt::SkipEmptyParts);
 }
 
-bool Git::hasModifiedFiles()
+// "\x1e<hash>\x1f<age>\x1f<date>\x1f<subject>\n\n<added>\t<deleted>\t<path>\n..." per commit, "-" counts for
+// binary files
+QList<FileHistoryEntry> Git::parseFileHistory(const QByteArray &out)
 {
-    if (!isInitialized()) {
-        return true;
+    QList<FileHistoryEntry> entries;
+    for (const QByteArray &record : out.split('\x1e')) {
+        const QList<QByteArray> lines = record.split('\n');
+        const QList<QByteArray> fields = lines.constFirst().split('\x1f');
+        if (fields.size() != 4) {
+            continue;
+        }
+        FileHistoryEntry entry {QString::fromLatin1(fields.at(0)), QString::fromUtf8(fields.at(1)),
+                                QString::fromUtf8(fields.at(2)), QString::fromUtf8(fields.at(3))};
+        for (qsizetype i = 1; i < lines.size(); ++i) {
+            const QList<QByteArray> counts = lines.at(i).split('\t');
+            if (counts.size() < 3) {
+                continue;
+            }
+            if (counts.at(0) == "-") {
+                entry.binary = true;
+            } else {
+                entry.added += counts.at(0).toLongLong();
+                entry.deleted += counts.at(1).toLongLong();
+            }
+        }
+        entries.append(entry);
     }
-    return !cmd.getOut("git status --porcelain 2>/dev/null", true).isEmpty();
+    return entries;
+}
+
+bool Git::initializeDirectory(const QString &dir)
+{
+    const DirPin pin(this, dir);
+    return isInitialized(dir) || initialize();
+}
+
+bool Git::runIn(const QString &dir, const QStringList &args, const QByteArray &input)
+{
+    const DirPin pin(this, dir);
+    return runGit(args, input);
 }
 
 bool Git::initialize()
 {
-    return cmd.run("git init", nullptr, nullptr, false, needElevation());
+    largeProfileDirs.remove(currentDir());
+    return runGit({"init"});
+}
+
+// Settings for directories with many files. The untracked cache and the fsmonitor daemon (where this git
+// has it) let status skip unchanged directories, manyFiles selects index v4 and skip-hash, the split index
+// keeps rewrites of a large index small and the commit-graph with changed-path Bloom filters serves log.
+bool Git::writeLargeProfile()
+{
+    QList<QPair<QString, QString>> settings {{"feature.manyFiles", "true"},   {"index.version", "4"},
+                                             {"core.untrackedCache", "true"}, {"core.splitIndex", "true"},
+                                             {"core.commitGraph", "true"},    {"gc.writeCommitGraph", "true"}};
+    if (fsmonitorAvailable()) {
+        settings.append({"core.fsmonitor", "true"});
+    }
+    settings.append({LargeProfileKey, "large"});
+    for (const auto &[key, value] : std::as_const(settings)) {
+        if (!runGit({"config", key, value})) {
+            return false;
+        }
+    }
+    largeProfileDirs.insert(currentDir(), true);
+    return true;
+}
+
+// libgit2 reads neither the untracked cache nor fsmonitor data and rejects a split index, and it doesn't
+// run filter drivers, so a chunked file it re-hashes differs from its pointer blob. Scans and tree diffs of
+// those repositories go through git.
+const GitBackend &Git::readBackend()
+{
+    return hasLargeProfile() || usesChunkStore() ? *cliBackend : *backend;
+}
+
+JobCommand Git::statusCommand()
+{
+    return readBackend().statusCommand();
+}
+
+// Cached per directory like hasLargeProfile, the setting only changes through setChunkThreshold
+bool Git::usesChunkStore()
+{
+    const QString dir = currentDir();
+    if (const auto it = chunkedDirs.constFind(dir); it != chunkedDirs.cend()) {
+        return *it;
+    }
+    const bool chunked = chunkThreshold() > 0;
+    chunkedDirs.insert(dir, chunked);
+    return chunked;
+}
+
+QString Git::configValue(const QString &key)
+{
+    const JobResult result = wait({{"git", {"config", "--get", key}, {}}}).constFirst();
+    return result.ok() ? QString::fromUtf8(result.out).trimmed() : QString();
 }
 
-bool Git::isInitialized()
+qint64 Git::timeStatus()
 {
-    return QProcess::execute("git", {"rev-parse", "--is-inside-work-tree"}) == 0;
+    QElapsedTimer timer;
+    timer.start();
+    return wait({statusCommand()}).constFirst().ok() ? timer.elapsed() : -1;
 }
 
-bool Git::needElevation()
+// git without a shell in between, elevated if the directory isn't writable. Paths given on stdin are taken
+// literally, so names with spaces or glob characters need no quoting.
+bool Git::runGit(const QStringList &args, const QByteArray &input, const Cmd::Stream *stream)
 {
-    return !QFileInfo(QDir::currentPath() + "/.").isWritable();
+    const QStringList gitArgs = QStringList {"--literal-pathspecs"} + args;
+    const QByteArray *stdinData = input.isEmpty() ? nullptr : &input;
+    const QString dir = currentDir();
+    cmd.setWorkingDirectory(dir);
+    if (stream) {
+        return cmd.procStream("git", gitArgs, *stream, stdinData, false, needElevation(dir));
+    }
+    return cmd.proc("git", gitArgs, nullptr, stdinData, false, needElevation(dir));
+}
+
+bool Git::addPaths(const QStringList &files, const QString &phase, qint64 totalFiles)
+{
+    const QStringList args {"add", "--verbose", "--pathspec-from-file=-", "--pathspec-file-nul"};
+    return phase.isEmpty() ? runGit(args, pathspecInput(files)) : runStep(phase, totalFiles, args, pathspecInput(files));
+}
+
+bool Git::isCancelable() const
+{
+    return !needElevation(currentDir()) || getuid() == 0;
+}
+
+// Stop the running step; the index is put back as it was before that step started
+void Git::cancelOperation()
+{
+    if (progress.cancelable) {
+        canceled = true;
+        cmd.cancel();
+    }
+}
+
+// Steps of a snapshot or restore replace the index by renaming a new file over it, a hard link to the
+// current one before every step is enough to roll back an interrupted step
+void Git::beginOperation()
+{
+    canceled = false;
+    gitDir.clear();
+    progress = OperationProgress {};
+    progress.cancelable = isCancelable();
+    if (progress.cancelable) {
+        gitDir = QString::fromUtf8(wait({{"git", {"rev-parse", "--absolute-git-dir"}, {}}}).constFirst().out).trimmed();
+    }
+}
+
+void Git::endOperation()
+{
+    if (!gitDir.isEmpty()) {
+        const QString index = gitDir + "/index";
+        const QString backup = gitDir + "/index.restore-gui";
+        if (canceled) {
+            // The process group is gone, a lock file left behind is ours
+            QFile::remove(index + ".lock");
+            QFile::remove(index);
+            if (QFile::exists(backup)) {
+                QFile::rename(backup, index);
+            }
+            qDebug() << "Operation canceled, index restored";
+        }
+        QFile::remove(backup);
+    }
+    lastCanceled = canceled;
+    canceled = false;
+    emit operationFinished();
+}
+
+bool Git::runStep(const QString &phase, qint64 totalFiles, const QStringList &args, const QByteArray &input)
+{
+    if (canceled) {
+        return false;
+    }
+    if (!gitDir.isEmpty()) {
+        const QString backup = gitDir + "/index.restore-gui";
+        QFile::remove(backup);
+        // Fails before the first add, there is no index yet and canceling removes the new one
+        ::link(QFile::encodeName(gitDir + "/index").constData(), QFile::encodeName(backup).constData());
+    }
+    progress.phase = phase;
+    progress.files = 0;
+    progress.totalFiles = totalFiles;
+    progress.bytes = 0;
+    progressTimer.start();
+    emit operationProgress(progress);
+
+    const Cmd::Stream stream {.output = [this](QByteArrayView line) { parseProgress(line, false); },
+                              .error = [this](QByteArrayView line) { parseProgress(line, true); }};
+    const bool ok = runGit(args, input, &stream);
+    emit operationProgress(progress);
+    return ok && !canceled;
+}
+
+// One line of output: "add 'path'" from --verbose counts a file and its bytes, "<phase>: NN% (x/y)" from
+// --progress gives git's own counters
+void Git::parseProgress(QByteArrayView line, bool isStderr)
+{
+    static const QRegularExpression gitProgress(QStringLiteral("^([^:]+):\\s+\\d+% \\((\\d+)/(\\d+)\\)"));
+    if (isStderr) {
+        const QRegularExpressionMatch match = gitProgress.match(QString::fromUtf8(line));
+        if (match.hasMatch()) {
+            progress.files = match.captured(2).toLongLong();
+            progress.totalFiles = match.captured(3).toLongLong();
+        }
+    } else if (line.startsWith("add '") && line.endsWith('\'')) {
+        // Relative to the directory git runs in, which the user may have navigated away from meanwhile
+        ++progress.files;
+        progress.bytes += QFileInfo(QDir(currentDir()), QString::fromUtf8(line.sliced(5, line.size() - 6))).size();
+    }
+    if (progressTimer.elapsed() >= 100) {
+        progressTimer.restart();
+        emit operationProgress(progress);
+    }
+}
+
+// NUL separated for --pathspec-file-nul, there is no limit on how many paths fit
+QByteArray Git::pathspecInput(const QStringList &files)
+{
+    QByteArray input;
+    for (const QString &file : files) {
+        input.append(file.toUtf8());
+        input.append('\0');
+    }
+    return input;
+}
+
+// From the file system like every other repository lookup, no git process per call
+bool Git::isInitialized(const QString &dir)
+{
+    return !RepoCache::findGitDir(dir.isEmpty() ? QDir::currentPath() : dir).isEmpty();
+}
+
+// Entries in the index of the current repository from its header, without running git; 0 if there is none
+qint64 Git::indexEntries()
+{
+    const QString dir = RepoCache::findGitDir(QDir::currentPath());
+    QFile file(dir + "/index");
+    if (dir.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    const QByteArray header = file.read(12);
+    if (header.size() < 12 || !header.startsWith("DIRC")) {
+        return 0;
+    }
+    return qFromBigEndian<quint32>(header.constData() + 8);
+}
+
+// The built-in daemon is only compiled into git on some platforms
+bool Git::fsmonitorAvailable()
+{
+    static const bool available = [] {
+        QProcess proc;
+        proc.start("git", {"version", "--build-options"});
+        proc.waitForFinished();
+        return proc.readAllStandardOutput().contains("feature: fsmonitor--daemon");
+    }();
+    return available;
+}
+
+bool Git::needElevation(const QString &dir)
+{
+    return !QFileInfo((dir.isEmpty() ? QDir::currentPath() : dir) + "/.").isWritable();
+}
+
+QString Git::currentDir() const
+{
+    return pinnedDir.isEmpty() ? QDir::currentPath() : pinnedDir;
+}
+
+// Only the outermost pin of nested operations (applyRetentionIfDue -> applyRetention) sets and clears it
+Git::DirPin::DirPin(Git *git, const QString &dir)
+    : git(git),
+      owner(git->pinnedDir.isEmpty())
+{
+    if (owner) {
+        git->pinnedDir = dir.isEmpty() ? QDir::currentPath() : dir;
+    }
+}
+
+Git::DirPin::~DirPin()
+{
+    if (owner) {
+        git->pinnedDir.clear();
+    }
 }
 
 QString Git::getCurrentBranch()
 {
-    return cmd.getOut("git branch --show-current");
+    return QString::fromUtf8(wait({backend->currentBranchCommand()}).constFirst().out).trimmed();
 }
 
-// Try to guess if the directory has a lot of file in a quick way
-bool Git::isLargeDirectory()
+// Describe the size of the directory if a first snapshot of it would be expensive, empty otherwise
+QString Git::largeDirectoryEstimate(const DirScanner::Result &size)
 {
-    return cmd.getOut("find " + QDir::currentPath() + " -maxdepth 3 2>/dev/null | wc -l").toUInt() > 500;
+    constexpr qint64 largeBytes = qint64(1) << 30;
+
+    if (size.files < LargeFiles && size.bytes < largeBytes) {
+        return {};
+    }
+
+    const QLocale locale;
+    const QString files = size.files >= 1000000 ? locale.toString(size.files / 1e6, 'f', 1) + 'M'
+                          : size.files >= 1000  ? locale.toString(size.files / 1000) + 'k'
+                                                : locale.toString(size.files);
+    QString estimate = tr("%1%2 files, %3")
+                           .arg(size.complete ? QStringLiteral("~") : QStringLiteral(">"), files,
+                                locale.formattedDataSize(size.bytes));
+    QStringList largest;
+    for (const auto &[name, bytes] : size.largestDirs) {
+        if (bytes >= size.bytes / 10) {
+            largest << QStringLiteral("%1 %2").arg(name, locale.formattedDataSize(bytes));
+        }
+    }
+    if (!largest.isEmpty()) {
+        estimate += tr("; largest: %1").arg(largest.join(QStringLiteral(", ")));
+    }
+    return estimate;
 }
@@ -22,40 +22,196 @@
 #ifndef GIT_H
 #define GIT_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 #include <QString>
 
+#include <functional>
+#include <memory>
+
 #include "cmd.h"
+#include "dirscanner.h"
+#include "gitbackend.h"
+#include "jobqueue.h"
+#include "repocache.h"
+#include "retention.h"
+#include "statusengine.h"
+
+// State of a running snapshot or restore, for a progress dialog
+struct OperationProgress {
+    QString phase;
+    qint64 files {0};
+    qint64 totalFiles {0}; // 0 if unknown
+    qint64 bytes {0};
+    bool cancelable {false};
+};
+
+// Outcome of Git::applyLargeProfile, timings of one status scan before and after, -1 if not taken
+struct ProfileReport {
+    bool ok {false};
+    bool fsmonitor {false};
+    qint64 statusBeforeMs {-1};
+    qint64 statusAfterMs {-1};
+};
+
+// Outcome of Git::applyRetention, checkpoint counts of the current branch before and after
+struct RetentionReport {
+    bool ok {false};
+    qsizetype before {0};
+    qsizetype after {0};
+    qsizetype backupsDeleted {0};
+};
+
+// One checkpoint that changed a path, from Git::fileHistoryAsync, with line counts summed over its files
+struct FileHistoryEntry {
+    QString commit;
+    QString age;
+    QString date;
+    QString message;
+    qint64 added {0};
+    qint64 deleted {0};
+    bool binary {false};
+};
 
 class Git : public QObject
 {
     Q_OBJECT
 public:
+    // Repository settings chosen when the first checkpoint is made, see applyLargeProfile
+    enum class Profile { Default, LargeDirectory };
+    static constexpr qint64 LargeFiles = 20000;
+
     explicit Git(QObject *parent = nullptr);
+    [[nodiscard]] QString backendName() const;
     [[nodiscard]] QString createBackupBranch();
     [[nodiscard]] QString getEmailGit();
     [[nodiscard]] QString getUserGit();
     [[nodiscard]] QString resetToCommit(const QString &commit);
     [[nodiscard]] QStringList getStatus(const QString &commit);
+    [[nodiscard]] bool hasLargeProfile();
+    [[nodiscard]] bool retentionEnabled();
     [[nodiscard]] bool hasModifiedFiles();
-    [[nodiscard]] static bool needElevation();
-    [[nodiscard]] QStringList listCommits();
+    [[nodiscard]] qint64 chunkThreshold();
+    [[nodiscard]] static qint64 indexEntries();
+    [[nodiscard]] static bool fsmonitorAvailable();
+    [[nodiscard]] static QString largeDirectoryEstimate(const DirScanner::Result &size);
+    [[nodiscard]] static bool isInitialized(const QString &dir = {});
+    [[nodiscard]] static bool needElevation(const QString &dir = {});
+    [[nodiscard]] QStringList listCommits(int count = -1);
     void add(const QStringList &files);
-    void commit(const QStringList &files, const QString &message);
+    ProfileReport applyLargeProfile();
+    RetentionReport applyRetention(const Retention::Policy &policy = {});
+    bool applyRetentionIfDue();
+    bool commit(const QStringList &files, const QString &message, qint64 expectedFiles = 0,
+                Profile profile = Profile::Default);
     void popStash();
     void rebaseToPrevious(const QString &commit);
-    void revertFiles(const QString &commit, const QStringList &files);
+    bool revertFiles(const QString &commit, const QStringList &files);
+    bool setChunkThreshold(qint64 mib);
     void setEmailGit(const QString &email);
+    void setRetentionEnabled(bool enabled);
     void setUserGit(const QString &name);
-    void stash(const QStringList &files = QStringList());
+    // For restore-gui --watch, which serves several trees from one process: make dir a repository if it
+    // isn't in one, and run git in it, elevated where the tree isn't writable
+    bool initializeDirectory(const QString &dir);
+    bool runIn(const QString &dir, const QStringList &args, const QByteArray &input = {});
+    bool stash(const QStringList &files = QStringList());
+    // Whether the last snapshot or restore was stopped through cancelOperation
+    [[nodiscard]] bool wasCanceled() const { return lastCanceled; }
+
+    // Non-blocking variants, results are delivered on the GUI thread unless context was destroyed
+    // maxFileBytes > 0 summarizes larger files instead of diffing them
+    quint64 diffAsync(const QString &commit, const QStringList &files, QObject *context,
+                      const std::function<void(const QByteArray &chunk)> &output,
+                      const std::function<void(bool ok, const QString &error)> &done, qint64 maxFileBytes = 0);
+    quint64 fileHistoryAsync(const QString &path, QObject *context,
+                             const std::function<void(bool ok, const QList<FileHistoryEntry> &)> &callback);
+    quint64 getStatusAsync(const QString &commit, const WorktreeStatus &worktree, QObject *context,
+                           const std::function<void(const ChangeList &)> &callback);
+    quint64 listCommitsAsync(int skip, int count, QObject *context,
+                             const std::function<void(bool ok, const QStringList &)> &callback);
+    quint64 scanWorktreeAsync(QObject *context, const std::function<void(const WorktreeStatus &)> &callback);
+    [[nodiscard]] std::optional<WorktreeStatus> cachedWorktree();
+    void prefetch(const QStringList &dirs, int commits);
+    void cancelJob(quint64 id);
+    void cancelOperation();
+    void cancelOtherDirectories(const QString &dir);
+
+signals:
+    void commandFinished();
+    void commandStarted();
+    void operationFinished();
+    void operationProgress(const OperationProgress &progress);
+    // HEAD or a branch of dir moved outside of what the caller is waiting for (snapshot, restore, CLI)
+    void repositoryChanged(const QString &dir);
 
 private:
+    // Keeps the directory a multi-step operation started in for all of its steps, the user can navigate
+    // while the nested event loops of wait() and Cmd run
+    class DirPin
+    {
+    public:
+        explicit DirPin(Git *git, const QString &dir = {});
+        ~DirPin();
+        DirPin(const DirPin &) = delete;
+        DirPin &operator=(const DirPin &) = delete;
+
+    private:
+        Git *git;
+        bool owner;
+    };
+
+    // One line of "git diff --raw -z"
+    struct RawChange {
+        QByteArray oldOid;
+        QByteArray newOid;
+        char status {};
+        QString path;
+    };
+
     Cmd cmd;
+    std::unique_ptr<GitBackend> backend; // outlives jobs, whose pool threads may still be in it
+    std::unique_ptr<GitBackend> cliBackend;
+    JobQueue jobs;
+    RepoCache cache;
+    OperationProgress progress;
+    QElapsedTimer progressTimer;
+    QString gitDir;
+    QString pinnedDir;
+    QHash<QString, bool> largeProfileDirs;
+    QHash<QString, bool> chunkedDirs;
+    QHash<quint64, quint64> jobChains; // first job id -> current step
+    bool canceled {false};
+    bool lastCanceled {false};
 
+    [[nodiscard]] QString currentDir() const;
     [[nodiscard]] QString getCurrentBranch();
     [[nodiscard]] bool initialize();
-    [[nodiscard]] static bool isInitialized();
-    [[nodiscard]] bool isLargeDirectory();
+    [[nodiscard]] bool isCancelable() const;
+    [[nodiscard]] const GitBackend &readBackend();
+    [[nodiscard]] JobCommand statusCommand();
+    [[nodiscard]] bool usesChunkStore();
+    [[nodiscard]] QString configValue(const QString &key);
+    [[nodiscard]] qint64 timeStatus();
+    bool writeLargeProfile();
+    bool markLargeFiles(const QStringList &files);
+    bool addPaths(const QStringList &files, const QString &phase = {}, qint64 totalFiles = 0);
+    bool runGit(const QStringList &args, const QByteArray &input = {}, const Cmd::Stream *stream = nullptr);
+    bool runStep(const QString &phase, qint64 totalFiles, const QStringList &args, const QByteArray &input = {});
+    void beginOperation();
+    void endOperation();
+    void parseProgress(QByteArrayView line, bool isStderr);
+    [[nodiscard]] QList<JobResult> wait(const QList<JobCommand> &commands);
+    quint64 streamDiff(const QString &dir, const QString &commit, const QStringList &pathspec, QObject *context,
+                       const std::function<void(const QByteArray &)> &output,
+                       const std::function<void(bool, const QString &)> &done);
+
+    [[nodiscard]] static QByteArray pathspecInput(const QStringList &files);
+    [[nodiscard]] static QStringList parseCommits(const QList<JobResult> &results);
+    [[nodiscard]] static QList<FileHistoryEntry> parseFileHistory(const QByteArray &out);
+    [[nodiscard]] static QList<RawChange> parseRawDiff(const QByteArray &out);
+    [[nodiscard]] static bool isNullOid(const QByteArray &oid);
 };
 
 #endif // GIT_H
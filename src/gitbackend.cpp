@@ -0,0 +1,120 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "gitbackend.h"
+
+#include <QDebug>
+
+#ifdef HAVE_LIBGIT2
+    #include "libgit2backend.h"
+#endif
+
+namespace
+{
+QString preferredBackend;
+}
+
+std::unique_ptr<GitBackend> GitBackend::create(const QString &name)
+{
+#ifdef HAVE_LIBGIT2
+    if (name == "libgit2" || name == "auto" || name.isEmpty()) {
+        return std::make_unique<LibGit2Backend>();
+    }
+#else
+    if (name == "libgit2") {
+        qWarning() << "Built without libgit2, using the git command line backend";
+    }
+#endif
+    return std::make_unique<CliBackend>();
+}
+
+QStringList GitBackend::available()
+{
+#ifdef HAVE_LIBGIT2
+    return {"cli", "libgit2"};
+#else
+    return {"cli"};
+#endif
+}
+
+// Command line option first, then RESTORE_GUI_BACKEND
+QString GitBackend::preferred()
+{
+    if (!preferredBackend.isEmpty()) {
+        return preferredBackend;
+    }
+    const QString env = qEnvironmentVariable("RESTORE_GUI_BACKEND");
+    return env.isEmpty() ? QStringLiteral("auto") : env;
+}
+
+void GitBackend::setPreferred(const QString &name)
+{
+    preferredBackend = name;
+}
+
+QString CliBackend::name() const
+{
+    return QStringLiteral("cli");
+}
+
+JobCommand CliBackend::configCommand(const QString &key) const
+{
+    return {"git", {"config", "--global", "--get", key}, {}};
+}
+
+JobCommand CliBackend::currentBranchCommand() const
+{
+    return {"git", {"branch", "--show-current"}, {}};
+}
+
+JobCommand CliBackend::diffCommand(const QString &commit, const QStringList &files) const
+{
+    return {"git", QStringList {"diff", "--color=never", commit, "--"} + files, {}};
+}
+
+JobCommand CliBackend::logCommand(int skip, int count) const
+{
+    QStringList args {"log", "--pretty=format:%h|%cr - %s"};
+    if (skip > 0) {
+        args << "--skip=" + QString::number(skip);
+    }
+    if (count >= 0) {
+        args << "-n" << QString::number(count);
+    }
+    return {"git", args, {}};
+}
+
+JobCommand CliBackend::listTreeCommand(const QString &commit) const
+{
+    return {"git", {"ls-tree", "-r", "-z", "--name-only", commit}, {}};
+}
+
+JobCommand CliBackend::statusCommand() const
+{
+    return {"git",
+            {"status", "--porcelain=v2", "-z", "--branch", "--untracked-files=all", "--no-renames"},
+            {}};
+}
+
+JobCommand CliBackend::treeDiffCommand(const QString &commit) const
+{
+    return {"git", {"diff", "--name-status", "-z", "--no-renames", commit, "HEAD"}, {}};
+}
@@ -0,0 +1,75 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef GITBACKEND_H
+#define GITBACKEND_H
+
+#include <QStringList>
+
+#include <memory>
+
+#include "jobqueue.h"
+
+// Read-only repository queries. Each query is a JobCommand whose output matches the git command
+// line noted next to it, so both backends share the parsers and run through the same JobQueue.
+// Write operations (add, commit, stash, reset) always go through the git CLI and Cmd.
+class GitBackend
+{
+public:
+    virtual ~GitBackend() = default;
+
+    [[nodiscard]] virtual QString name() const = 0;
+    // git config --global --get <key>
+    [[nodiscard]] virtual JobCommand configCommand(const QString &key) const = 0;
+    // git branch --show-current
+    [[nodiscard]] virtual JobCommand currentBranchCommand() const = 0;
+    // git diff --color=never <commit> -- <files>
+    [[nodiscard]] virtual JobCommand diffCommand(const QString &commit, const QStringList &files) const = 0;
+    // git log --pretty=format:%h|%cr - %s --skip=<skip> -n <count>, count < 0 lists everything
+    [[nodiscard]] virtual JobCommand logCommand(int skip, int count) const = 0;
+    // git ls-tree -r -z --name-only <commit>
+    [[nodiscard]] virtual JobCommand listTreeCommand(const QString &commit) const = 0;
+    // git status --porcelain=v2 -z --branch --untracked-files=all --no-renames
+    [[nodiscard]] virtual JobCommand statusCommand() const = 0;
+    // git diff --name-status -z --no-renames <commit> HEAD
+    [[nodiscard]] virtual JobCommand treeDiffCommand(const QString &commit) const = 0;
+
+    // "cli", "libgit2" or "auto" (libgit2 when built with it)
+    [[nodiscard]] static std::unique_ptr<GitBackend> create(const QString &name);
+    [[nodiscard]] static QStringList available();
+    [[nodiscard]] static QString preferred();
+    static void setPreferred(const QString &name);
+};
+
+class CliBackend : public GitBackend
+{
+public:
+    [[nodiscard]] QString name() const override;
+    [[nodiscard]] JobCommand configCommand(const QString &key) const override;
+    [[nodiscard]] JobCommand currentBranchCommand() const override;
+    [[nodiscard]] JobCommand diffCommand(const QString &commit, const QStringList &files) const override;
+    [[nodiscard]] JobCommand logCommand(int skip, int count) const override;
+    [[nodiscard]] JobCommand listTreeCommand(const QString &commit) const override;
+    [[nodiscard]] JobCommand statusCommand() const override;
+    [[nodiscard]] JobCommand treeDiffCommand(const QString &commit) const override;
+};
+
+#endif // GITBACKEND_H
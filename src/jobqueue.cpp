@@ -0,0 +1,309 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "jobqueue.h"
+
+#include <QDebug>
+
+#include <csignal>
+
+#include "trace.h"
+
+JobQueue::JobQueue(QObject *parent, int maxRunning)
+    : QObject(parent),
+      maxRunning(maxRunning)
+{
+}
+
+JobQueue::~JobQueue()
+{
+    // Finished tasks post back to this object, let them drain before it goes away
+    pool.waitForDone();
+    for (Job *job : std::as_const(running)) {
+        abort(job);
+    }
+    for (const auto &queue : std::as_const(pending)) {
+        qDeleteAll(queue);
+    }
+}
+
+quint64 JobQueue::enqueue(const QString &dir, const QString &key, Priority priority, const QList<JobCommand> &commands,
+                          QObject *context, const Callback &callback)
+{
+    // Supersede stale work with the same key
+    if (!key.isEmpty()) {
+        auto &queue = pending[dir];
+        for (auto it = queue.begin(); it != queue.end();) {
+            if ((*it)->key == key) {
+                delete *it;
+                it = queue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        Job *current = running.value(dir);
+        if (current && current->key == key) {
+            running.remove(dir);
+            abort(current);
+        }
+    }
+
+    auto *job = new Job;
+    job->id = nextId++;
+    job->dir = dir;
+    job->key = key;
+    job->priority = priority;
+    job->commands = commands;
+    job->context = context;
+    job->callback = callback;
+    job->enqueuedUs = Trace::now();
+    pending[dir].append(job);
+    schedule();
+    return job->id;
+}
+
+void JobQueue::cancel(quint64 id)
+{
+    for (auto &queue : pending) {
+        for (qsizetype i = 0; i < queue.size(); ++i) {
+            if (queue.at(i)->id == id) {
+                delete queue.takeAt(i);
+                return;
+            }
+        }
+    }
+    for (auto it = running.begin(); it != running.end(); ++it) {
+        if (it.value()->id == id) {
+            Job *job = it.value();
+            running.erase(it);
+            abort(job);
+            schedule();
+            return;
+        }
+    }
+}
+
+void JobQueue::cancelDirectory(const QString &dir)
+{
+    drop(dir);
+    schedule();
+}
+
+void JobQueue::cancelOtherDirectories(const QString &dir)
+{
+    const QStringList dirs = pending.keys() + running.keys();
+    for (const QString &other : dirs) {
+        if (other != dir) {
+            drop(other);
+        }
+    }
+    schedule();
+}
+
+// Jobs without a key are kept: their callers wait for them in a nested event loop (Git::wait) that a
+// dropped job would never end
+void JobQueue::drop(const QString &dir)
+{
+    auto it = pending.find(dir);
+    if (it != pending.end()) {
+        for (auto job = it->begin(); job != it->end();) {
+            if ((*job)->key.isEmpty()) {
+                ++job;
+            } else {
+                delete *job;
+                job = it->erase(job);
+            }
+        }
+        if (it->isEmpty()) {
+            pending.erase(it);
+        }
+    }
+    if (Job *job = running.value(dir); job && !job->key.isEmpty()) {
+        running.remove(dir);
+        abort(job);
+    }
+}
+
+// Kill a job that has already been removed from the running table, its callback is never called
+void JobQueue::abort(Job *job)
+{
+    if (job->proc) {
+        job->proc->disconnect(this);
+        connect(job->proc, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), job->proc,
+                &QObject::deleteLater);
+        if (job->proc->state() == QProcess::NotRunning) {
+            job->proc->deleteLater();
+        } else {
+            job->proc->kill();
+        }
+    }
+    delete job;
+}
+
+void JobQueue::finish(Job *job)
+{
+    running.remove(job->dir);
+    if (job->context && job->callback) {
+        job->callback(job->results);
+    }
+    delete job;
+    schedule();
+}
+
+void JobQueue::schedule()
+{
+    while (running.size() < maxRunning) {
+        Job *best = nullptr;
+        for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+            if (running.contains(it.key())) {
+                continue;
+            }
+            for (Job *job : it.value()) {
+                if (!best || job->priority > best->priority || (job->priority == best->priority && job->id < best->id)) {
+                    best = job;
+                }
+            }
+        }
+        if (!best) {
+            return;
+        }
+        pending[best->dir].removeOne(best);
+        if (pending.value(best->dir).isEmpty()) {
+            pending.remove(best->dir);
+        }
+        running.insert(best->dir, best);
+        startNextCommand(best);
+    }
+}
+
+void JobQueue::startNextCommand(Job *job)
+{
+    if (job->results.size() == job->commands.size()) {
+        finish(job);
+        return;
+    }
+    // Copy, the job may already be finished and deleted if start() fails synchronously
+    const JobCommand command = job->commands.at(job->results.size());
+    job->commandStartUs = Trace::now();
+    job->outputBytes = 0;
+    if (command.task) {
+        pool.start([this, id = job->id, dir = job->dir, task = command.task] {
+            const JobResult result = task(dir);
+            QMetaObject::invokeMethod(this, [this, id, result] { taskFinished(id, result); }, Qt::QueuedConnection);
+        });
+        return;
+    }
+    auto *proc = new QProcess(this);
+    job->proc = proc;
+    proc->setWorkingDirectory(job->dir);
+    // Signals blocked by the caller (AutoCheckpoint's signalfd) would stay blocked in the command
+    proc->setChildProcessModifier([] {
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+    });
+
+    connect(proc, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, job, proc, output = command.output](int exitCode, QProcess::ExitStatus status) {
+                JobResult result;
+                result.exitCode = (status == QProcess::NormalExit) ? exitCode : -1;
+                result.out = proc->readAllStandardOutput();
+                result.err = proc->readAllStandardError();
+                job->outputBytes += result.out.size();
+                traceCommand(job, Trace::commandName(proc->program(), proc->arguments()), result.exitCode);
+                if (output) {
+                    if (job->context && !result.out.isEmpty()) {
+                        output(result.out);
+                    }
+                    result.out.clear();
+                }
+                job->results.append(result);
+                job->proc = nullptr;
+                proc->deleteLater();
+                startNextCommand(job);
+            });
+    if (command.output) {
+        connect(proc, &QProcess::readyReadStandardOutput, this, [job, proc, output = command.output] {
+            const QByteArray chunk = proc->readAllStandardOutput();
+            job->outputBytes += chunk.size();
+            if (job->context) {
+                output(chunk);
+            }
+        });
+    }
+    connect(proc, &QProcess::errorOccurred, this, [this, job, proc](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) {
+            return;
+        }
+        qDebug() << "Failed to start" << proc->program() << proc->errorString();
+        job->results.append(JobResult {});
+        job->proc = nullptr;
+        proc->deleteLater();
+        startNextCommand(job);
+    });
+
+    proc->start(command.program, command.args);
+    if (proc->state() == QProcess::NotRunning) {
+        return;
+    }
+    if (!command.input.isEmpty()) {
+        proc->write(command.input);
+    }
+    proc->closeWriteChannel();
+}
+
+// In-process tasks can't be interrupted, a result for a job that was canceled meanwhile is dropped
+void JobQueue::taskFinished(quint64 id, const JobResult &result)
+{
+    for (Job *job : std::as_const(running)) {
+        if (job->id == id) {
+            job->outputBytes = result.out.size();
+            traceCommand(job, "task " + job->key.section(':', 0, 0), result.exitCode);
+            const JobCommand &command = job->commands.at(job->results.size());
+            if (command.output) {
+                if (job->context && !result.out.isEmpty()) {
+                    command.output(result.out);
+                }
+                job->results.append({result.exitCode, {}, result.err});
+            } else {
+                job->results.append(result);
+            }
+            startNextCommand(job);
+            return;
+        }
+    }
+}
+
+// One span per command, from its start to its result, with the time the job waited in the queue
+void JobQueue::traceCommand(const Job *job, const QString &name, int exitCode)
+{
+    if (!Trace::enabled()) {
+        return;
+    }
+    QJsonObject args {{"dir", job->dir}, {"exit_code", exitCode}, {"output_bytes", job->outputBytes}};
+    if (!job->key.isEmpty()) {
+        args.insert("key", job->key);
+    }
+    if (job->results.isEmpty()) {
+        args.insert("queued_us", job->commandStartUs - job->enqueuedUs);
+    }
+    Trace::complete("job", name, job->commandStartUs, args);
+}
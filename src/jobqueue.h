@@ -0,0 +1,105 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QProcess>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <functional>
+
+struct JobResult {
+    int exitCode {-1};
+    QByteArray out;
+    QByteArray err;
+    [[nodiscard]] bool ok() const { return exitCode == 0; }
+};
+
+struct JobCommand {
+    QString program;
+    QStringList args;
+    QByteArray input;
+    // In-process alternative to program/args, run on a pool thread with the job's directory
+    std::function<JobResult(const QString &dir)> task {};
+    // Receives stdout on the GUI thread as it arrives instead of JobResult::out (tasks deliver it in one piece)
+    std::function<void(const QByteArray &chunk)> output {};
+};
+
+// Runs commands without blocking the GUI thread. Every directory has its own queue, at most one
+// job per directory runs at a time and the highest priority pending job goes first. Enqueuing a
+// job with the same key as a queued or running job in that directory supersedes the older one.
+// Callbacks are invoked on the GUI thread, and skipped if their context object is gone. Canceling a
+// directory leaves its jobs without a key alone, see drop.
+class JobQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Priority { Low, Normal, High };
+    using Callback = std::function<void(const QList<JobResult> &)>;
+
+    explicit JobQueue(QObject *parent = nullptr, int maxRunning = 2);
+    ~JobQueue() override;
+
+    quint64 enqueue(const QString &dir, const QString &key, Priority priority, const QList<JobCommand> &commands,
+                    QObject *context, const Callback &callback);
+    void cancel(quint64 id);
+    void cancelDirectory(const QString &dir);
+    void cancelOtherDirectories(const QString &dir);
+
+private:
+    struct Job {
+        quint64 id {};
+        QString dir;
+        QString key;
+        Priority priority {Priority::Normal};
+        QList<JobCommand> commands;
+        QList<JobResult> results;
+        QPointer<QObject> context;
+        Callback callback;
+        QProcess *proc {nullptr};
+        // Trace timestamps (Trace::now()) and the stdout of the running command
+        qint64 enqueuedUs {0};
+        qint64 commandStartUs {0};
+        qint64 outputBytes {0};
+    };
+
+    QHash<QString, QList<Job *>> pending;
+    QHash<QString, Job *> running;
+    QThreadPool pool;
+    int maxRunning;
+    quint64 nextId {1};
+
+    void abort(Job *job);
+    void drop(const QString &dir);
+    void finish(Job *job);
+    void schedule();
+    void startNextCommand(Job *job);
+    void taskFinished(quint64 id, const JobResult &result);
+    static void traceCommand(const Job *job, const QString &name, int exitCode);
+};
+
+#endif // JOBQUEUE_H
@@ -0,0 +1,441 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "libgit2backend.h"
+
+#include <QDateTime>
+
+#include <vector>
+
+#include <git2.h>
+
+namespace
+{
+template <typename T, void (*Free)(T *)> struct Deleter {
+    void operator()(T *ptr) const { Free(ptr); }
+};
+using Repository = std::unique_ptr<git_repository, Deleter<git_repository, git_repository_free>>;
+using Object = std::unique_ptr<git_object, Deleter<git_object, git_object_free>>;
+using Diff = std::unique_ptr<git_diff, Deleter<git_diff, git_diff_free>>;
+
+// Same exit code and message shape as a failing git command
+JobResult failure()
+{
+    const git_error *error = git_error_last();
+    return {128, {}, error ? QByteArray(error->message) + '\n' : QByteArray("libgit2 error\n")};
+}
+
+Repository openRepository(const QString &dir)
+{
+    git_repository *repo = nullptr;
+    if (git_repository_open_ext(&repo, dir.toUtf8().constData(), 0, nullptr) != 0) {
+        return nullptr;
+    }
+    return Repository(repo);
+}
+
+Object resolveTree(git_repository *repo, const QString &spec)
+{
+    git_object *obj = nullptr;
+    if (git_revparse_single(&obj, repo, spec.toUtf8().constData()) != 0) {
+        return nullptr;
+    }
+    Object commit(obj);
+    git_object *tree = nullptr;
+    if (git_object_peel(&tree, commit.get(), GIT_OBJECT_TREE) != 0) {
+        return nullptr;
+    }
+    return Object(tree);
+}
+
+char deltaStatus(git_delta_t status)
+{
+    switch (status) {
+    case GIT_DELTA_ADDED:
+        return 'A';
+    case GIT_DELTA_DELETED:
+        return 'D';
+    case GIT_DELTA_TYPECHANGE:
+        return 'T';
+    default:
+        return 'M';
+    }
+}
+
+int printDiffLine(const git_diff_delta * /*delta*/, const git_diff_hunk * /*hunk*/, const git_diff_line *line,
+                  void *payload)
+{
+    auto *out = static_cast<QByteArray *>(payload);
+    if (line->origin == GIT_DIFF_LINE_CONTEXT || line->origin == GIT_DIFF_LINE_ADDITION
+        || line->origin == GIT_DIFF_LINE_DELETION) {
+        out->append(line->origin);
+    }
+    out->append(line->content, static_cast<qsizetype>(line->content_len));
+    return 0;
+}
+
+int collectTreeEntry(const char *root, const git_tree_entry *entry, void *payload)
+{
+    if (git_tree_entry_type(entry) == GIT_OBJECT_BLOB) {
+        auto *out = static_cast<QByteArray *>(payload);
+        out->append(root);
+        out->append(git_tree_entry_name(entry));
+        out->append('\0');
+    }
+    return 0;
+}
+
+// Porcelain v2 "ordinary changed entry", modes and object ids are not used by the parser
+QByteArray changedRecord(char x, char y, const char *path)
+{
+    static const QByteArray zeroOid(40, '0');
+    return QByteArray("1 ") + x + y + " N... 000000 000000 000000 " + zeroOid + ' ' + zeroOid + ' ' + path + '\0';
+}
+
+JobResult queryConfig(const QString &key)
+{
+    git_config *cfg = nullptr;
+    if (git_config_open_default(&cfg) != 0) {
+        return failure();
+    }
+    git_buf buf = GIT_BUF_INIT;
+    const int rc = git_config_get_string_buf(&buf, cfg, key.toUtf8().constData());
+    JobResult result;
+    result.exitCode = rc == 0 ? 0 : 1; // git config --get exits 1 for a missing key
+    if (rc == 0) {
+        result.out = QByteArray(buf.ptr, static_cast<qsizetype>(buf.size)) + '\n';
+    }
+    git_buf_dispose(&buf);
+    git_config_free(cfg);
+    return result;
+}
+
+JobResult queryCurrentBranch(const QString &dir)
+{
+    Repository repo = openRepository(dir);
+    if (!repo) {
+        return failure();
+    }
+    // Read HEAD's symbolic target so an unborn branch is reported too, like git does
+    git_reference *head = nullptr;
+    if (git_reference_lookup(&head, repo.get(), "HEAD") != 0) {
+        return failure();
+    }
+    JobResult result {0, {}, {}};
+    if (git_reference_type(head) == GIT_REFERENCE_SYMBOLIC) {
+        QByteArray target(git_reference_symbolic_target(head));
+        if (target.startsWith("refs/heads/")) {
+            result.out = target.mid(11) + '\n';
+        }
+    }
+    git_reference_free(head);
+    return result;
+}
+
+JobResult queryDiff(const QString &dir, const QString &commit, const QStringList &files)
+{
+    Repository repo = openRepository(dir);
+    if (!repo) {
+        return failure();
+    }
+    Object tree = resolveTree(repo.get(), commit);
+    if (!tree) {
+        return failure();
+    }
+    QList<QByteArray> paths;
+    std::vector<char *> pathPtrs;
+    for (const QString &file : files) {
+        paths.append(file.toUtf8());
+    }
+    for (QByteArray &path : paths) {
+        pathPtrs.push_back(path.data());
+    }
+    git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+    opts.pathspec.strings = pathPtrs.data();
+    opts.pathspec.count = pathPtrs.size();
+
+    git_diff *rawDiff = nullptr;
+    if (git_diff_tree_to_workdir_with_index(&rawDiff, repo.get(), reinterpret_cast<git_tree *>(tree.get()), &opts)
+        != 0) {
+        return failure();
+    }
+    Diff patch(rawDiff);
+    JobResult result {0, {}, {}};
+    if (git_diff_print(patch.get(), GIT_DIFF_FORMAT_PATCH, printDiffLine, &result.out) != 0) {
+        return failure();
+    }
+    return result;
+}
+
+JobResult queryLog(const QString &dir, int skip, int count)
+{
+    Repository repo = openRepository(dir);
+    if (!repo) {
+        return failure();
+    }
+    git_revwalk *walk = nullptr;
+    if (git_revwalk_new(&walk, repo.get()) != 0) {
+        return failure();
+    }
+    git_revwalk_sorting(walk, GIT_SORT_TIME);
+    if (git_revwalk_push_head(walk) != 0) {
+        git_revwalk_free(walk);
+        return failure();
+    }
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    JobResult result {0, {}, {}};
+    git_oid oid;
+    // Skipped commits are only walked, not loaded
+    while (skip > 0 && git_revwalk_next(&oid, walk) == 0) {
+        --skip;
+    }
+    while (count != 0 && git_revwalk_next(&oid, walk) == 0) {
+        if (count > 0) {
+            --count;
+        }
+        git_commit *commit = nullptr;
+        if (git_commit_lookup(&commit, repo.get(), &oid) != 0) {
+            continue;
+        }
+        git_buf shortId = GIT_BUF_INIT;
+        git_object_short_id(&shortId, reinterpret_cast<const git_object *>(commit));
+        const char *summary = git_commit_summary(commit);
+        if (!result.out.isEmpty()) {
+            result.out.append('\n');
+        }
+        result.out.append(shortId.ptr, static_cast<qsizetype>(shortId.size));
+        result.out.append('|');
+        result.out.append(LibGit2Backend::relativeDate(now - git_commit_time(commit)).toUtf8());
+        result.out.append(" - ");
+        result.out.append(summary ? summary : "");
+        git_buf_dispose(&shortId);
+        git_commit_free(commit);
+    }
+    git_revwalk_free(walk);
+    return result;
+}
+
+JobResult queryListTree(const QString &dir, const QString &commit)
+{
+    Repository repo = openRepository(dir);
+    if (!repo) {
+        return failure();
+    }
+    Object tree = resolveTree(repo.get(), commit);
+    if (!tree) {
+        return failure();
+    }
+    JobResult result {0, {}, {}};
+    if (git_tree_walk(reinterpret_cast<git_tree *>(tree.get()), GIT_TREEWALK_PRE, collectTreeEntry, &result.out)
+        != 0) {
+        return failure();
+    }
+    return result;
+}
+
+JobResult queryStatus(const QString &dir)
+{
+    Repository repo = openRepository(dir);
+    if (!repo) {
+        return failure();
+    }
+    JobResult result {0, {}, {}};
+    git_oid head;
+    if (git_reference_name_to_id(&head, repo.get(), "HEAD") == 0) {
+        result.out += QByteArray("# branch.oid ") + git_oid_tostr_s(&head) + '\0';
+    } else {
+        result.out += QByteArray("# branch.oid (initial)") + '\0';
+    }
+
+    git_status_options opts = GIT_STATUS_OPTIONS_INIT;
+    opts.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+    opts.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_RECURSE_UNTRACKED_DIRS;
+    git_status_list *list = nullptr;
+    if (git_status_list_new(&list, repo.get(), &opts) != 0) {
+        return failure();
+    }
+    const size_t count = git_status_list_entrycount(list);
+    for (size_t i = 0; i < count; ++i) {
+        const git_status_entry *entry = git_status_byindex(list, i);
+        const git_diff_delta *delta = entry->index_to_workdir ? entry->index_to_workdir : entry->head_to_index;
+        if (!delta) {
+            continue;
+        }
+        const char *path = delta->new_file.path ? delta->new_file.path : delta->old_file.path;
+        const unsigned int flags = entry->status;
+        if (flags & GIT_STATUS_CONFLICTED) {
+            result.out += QByteArray("u UU N... 000000 000000 000000 000000 0 0 0 ") + path + '\0';
+            continue;
+        }
+        if (flags == GIT_STATUS_WT_NEW) {
+            result.out += QByteArray("? ") + path + '\0';
+            continue;
+        }
+        char x = '.';
+        if (flags & GIT_STATUS_INDEX_NEW) {
+            x = 'A';
+        } else if (flags & GIT_STATUS_INDEX_DELETED) {
+            x = 'D';
+        } else if (flags & GIT_STATUS_INDEX_TYPECHANGE) {
+            x = 'T';
+        } else if (flags & (GIT_STATUS_INDEX_MODIFIED | GIT_STATUS_INDEX_RENAMED)) {
+            x = 'M';
+        }
+        char y = '.';
+        if (flags & GIT_STATUS_WT_DELETED) {
+            y = 'D';
+        } else if (flags & GIT_STATUS_WT_TYPECHANGE) {
+            y = 'T';
+        } else if (flags & (GIT_STATUS_WT_MODIFIED | GIT_STATUS_WT_RENAMED)) {
+            y = 'M';
+        }
+        if (x != '.' || y != '.') {
+            result.out += changedRecord(x, y, path);
+        }
+    }
+    git_status_list_free(list);
+    return result;
+}
+
+JobResult queryTreeDiff(const QString &dir, const QString &commit)
+{
+    Repository repo = openRepository(dir);
+    if (!repo) {
+        return failure();
+    }
+    Object oldTree = resolveTree(repo.get(), commit);
+    Object newTree = resolveTree(repo.get(), QStringLiteral("HEAD"));
+    if (!oldTree || !newTree) {
+        return failure();
+    }
+    git_diff *rawDiff = nullptr;
+    if (git_diff_tree_to_tree(&rawDiff, repo.get(), reinterpret_cast<git_tree *>(oldTree.get()),
+                              reinterpret_cast<git_tree *>(newTree.get()), nullptr)
+        != 0) {
+        return failure();
+    }
+    Diff changes(rawDiff);
+    JobResult result {0, {}, {}};
+    const size_t count = git_diff_num_deltas(changes.get());
+    for (size_t i = 0; i < count; ++i) {
+        const git_diff_delta *delta = git_diff_get_delta(changes.get(), i);
+        const char *path = delta->status == GIT_DELTA_DELETED ? delta->old_file.path : delta->new_file.path;
+        result.out += deltaStatus(delta->status);
+        result.out += '\0';
+        result.out += path;
+        result.out += '\0';
+    }
+    return result;
+}
+} // namespace
+
+LibGit2Backend::LibGit2Backend()
+{
+    git_libgit2_init();
+}
+
+LibGit2Backend::~LibGit2Backend()
+{
+    git_libgit2_shutdown();
+}
+
+QString LibGit2Backend::name() const
+{
+    return QStringLiteral("libgit2");
+}
+
+JobCommand LibGit2Backend::configCommand(const QString &key) const
+{
+    return {{}, {}, {}, [key](const QString &) { return queryConfig(key); }};
+}
+
+JobCommand LibGit2Backend::currentBranchCommand() const
+{
+    return {{}, {}, {}, queryCurrentBranch};
+}
+
+JobCommand LibGit2Backend::diffCommand(const QString &commit, const QStringList &files) const
+{
+    return {{}, {}, {}, [commit, files](const QString &dir) { return queryDiff(dir, commit, files); }};
+}
+
+JobCommand LibGit2Backend::logCommand(int skip, int count) const
+{
+    return {{}, {}, {}, [skip, count](const QString &dir) { return queryLog(dir, skip, count); }};
+}
+
+JobCommand LibGit2Backend::listTreeCommand(const QString &commit) const
+{
+    return {{}, {}, {}, [commit](const QString &dir) { return queryListTree(dir, commit); }};
+}
+
+JobCommand LibGit2Backend::statusCommand() const
+{
+    return {{}, {}, {}, queryStatus};
+}
+
+JobCommand LibGit2Backend::treeDiffCommand(const QString &commit) const
+{
+    return {{}, {}, {}, [commit](const QString &dir) { return queryTreeDiff(dir, commit); }};
+}
+
+// Same wording and rounding as git's "%cr" (show_date_relative in git's date.c)
+QString LibGit2Backend::relativeDate(qint64 seconds)
+{
+    if (seconds < 0) {
+        return QStringLiteral("in the future");
+    }
+    auto plural = [](qint64 n, const char *unit) {
+        return QString("%1 %2%3").arg(n).arg(unit).arg(n == 1 ? "" : "s");
+    };
+    if (seconds < 90) {
+        return plural(seconds, "second") + " ago";
+    }
+    qint64 diff = (seconds + 30) / 60;
+    if (diff < 90) {
+        return plural(diff, "minute") + " ago";
+    }
+    diff = (diff + 30) / 60;
+    if (diff < 36) {
+        return plural(diff, "hour") + " ago";
+    }
+    diff = (diff + 12) / 24;
+    if (diff < 14) {
+        return plural(diff, "day") + " ago";
+    }
+    if (diff < 70) {
+        return plural((diff + 3) / 7, "week") + " ago";
+    }
+    if (diff < 365) {
+        return plural((diff + 15) / 30, "month") + " ago";
+    }
+    if (diff < 1825) {
+        const qint64 totalMonths = (diff * 12 * 2 + 365) / (365 * 2);
+        const qint64 years = totalMonths / 12;
+        const qint64 months = totalMonths % 12;
+        if (months != 0) {
+            return plural(years, "year") + ", " + plural(months, "month") + " ago";
+        }
+        return plural(years, "year") + " ago";
+    }
+    return plural((diff + 183) / 365, "year") + " ago";
+}
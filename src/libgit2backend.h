@@ -0,0 +1,47 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef LIBGIT2BACKEND_H
+#define LIBGIT2BACKEND_H
+
+#include "gitbackend.h"
+
+// In-process backend, every query is a task that opens the repository with libgit2 on a pool
+// thread and renders the same bytes the git command line would print.
+class LibGit2Backend : public GitBackend
+{
+public:
+    LibGit2Backend();
+    ~LibGit2Backend() override;
+
+    [[nodiscard]] QString name() const override;
+    [[nodiscard]] JobCommand configCommand(const QString &key) const override;
+    [[nodiscard]] JobCommand currentBranchCommand() const override;
+    [[nodiscard]] JobCommand diffCommand(const QString &commit, const QStringList &files) const override;
+    [[nodiscard]] JobCommand logCommand(int skip, int count) const override;
+    [[nodiscard]] JobCommand listTreeCommand(const QString &commit) const override;
+    [[nodiscard]] JobCommand statusCommand() const override;
+    [[nodiscard]] JobCommand treeDiffCommand(const QString &commit) const override;
+
+    [[nodiscard]] static QString relativeDate(qint64 seconds);
+};
+
+#endif // LIBGIT2BACKEND_H
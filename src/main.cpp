@@ -29,15 +29,69 @@
 #include <QLocale>
 #include <QTranslator>
 
+#include "autocheckpoint.h"
+#include "gitbackend.h"
 #include "mainwindow.h"
+#include "trace.h"
 #include <unistd.h>
 
 #ifndef VERSION
     #define VERSION "?.?.?.?"
 #endif
 
+namespace
+{
+void addWatchOptions(QCommandLineParser &parser)
+{
+    parser.addOption({"watch", QObject::tr("Run without a window, checkpointing changes in the given directories")});
+    parser.addOption({"quiet-period",
+                      QObject::tr("With --watch, seconds without changes before a checkpoint is made (default 30)"),
+                      "seconds", "30"});
+}
+
+void addTraceOption(QCommandLineParser &parser)
+{
+    parser.addOption({"trace",
+                      QObject::tr("Write timings of commands and refreshes to <file> as a Chrome trace, "
+                                  "also enabled by RESTORE_GUI_TRACE=<file>"),
+                      "file"});
+}
+
+// Headless mode needs no display, it runs before QApplication is created
+int runWatcher(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName(QStringLiteral("MX-Linux"));
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    addWatchOptions(parser);
+    addTraceOption(parser);
+    parser.addPositionalArgument(QStringLiteral("<dir>"), QObject::tr("Directories to watch"), "<dir>...");
+    parser.process(app);
+    Trace::start(parser.value("trace"));
+
+    const QStringList dirs = parser.positionalArguments();
+    if (dirs.isEmpty()) {
+        qCritical().noquote() << QObject::tr("--watch needs at least one directory");
+        return EXIT_FAILURE;
+    }
+    AutoCheckpoint watcher(std::max(1, parser.value("quiet-period").toInt()));
+    bool watching = false;
+    for (const QString &dir : dirs) {
+        watching = watcher.watch(dir) || watching;
+    }
+    return watching ? QCoreApplication::exec() : EXIT_FAILURE;
+}
+} // namespace
+
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--watch") == 0) {
+            return runWatcher(argc, argv);
+        }
+    }
+
     if (getuid() == 0) {
         qputenv("XDG_RUNTIME_DIR", "/run/user/0");
         qunsetenv("SESSION_MANAGER");
@@ -80,7 +134,17 @@ int main(int argc, char *argv[])
     parser.addHelpOption();
     parser.addVersionOption();
     parser.addPositionalArgument(("<dir>"), QObject::tr("Starting path you want this app to display"));
+    parser.addOption({"backend",
+                      QObject::tr("Git backend used for reading repositories: %1 or auto")
+                          .arg(GitBackend::available().join(", ")),
+                      "name"});
+    addWatchOptions(parser);
+    addTraceOption(parser);
     parser.process(app);
+    Trace::start(parser.value("trace"));
+    if (parser.isSet("backend")) {
+        GitBackend::setPreferred(parser.value("backend"));
+    }
 
     // if (getuid() != 0) {
     MainWindow w(parser);
@@ -0,0 +1,162 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "maintenance.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+
+#include <memory>
+
+#include "chunkstore.h"
+#include "repocache.h"
+
+namespace
+{
+const QString LastRunKey = QStringLiteral("restore-gui.lastmaintenance");
+constexpr qint64 ManyLooseObjects = 5000;
+} // namespace
+
+Maintenance::Maintenance(QObject *parent)
+    : QObject(parent)
+{
+    if (!QStandardPaths::findExecutable("nice").isEmpty()) {
+        lowPriority << "nice" << "-n" << "19";
+    }
+    // Idle class: only gets the disk when nobody else wants it
+    if (!QStandardPaths::findExecutable("ionice").isEmpty()) {
+        lowPriority << "ionice" << "-c" << "3";
+    }
+}
+
+bool Maintenance::isDue(const MaintenanceStats &stats)
+{
+    if (!stats.isRepo) {
+        return false;
+    }
+    const int hours = QSettings().value("maintenance/intervalHours", 24).toInt();
+    return !stats.lastRun.isValid() || stats.lastRun.secsTo(QDateTime::currentDateTime()) >= hours * 3600LL
+           || stats.looseObjects >= ManyLooseObjects;
+}
+
+void Maintenance::run(const QString &dir, QObject *context, const std::function<void(bool ok)> &callback)
+{
+    // Repositories owned by root would need the elevated worker, they are left to root's own runs
+    if (!QFileInfo(dir + "/.").isWritable()) {
+        callback(false);
+        return;
+    }
+    auto timer = std::make_shared<QElapsedTimer>();
+    timer->start();
+    QList<JobCommand> commands {
+        git({"pack-refs", "--all", "--prune"}),
+        git({"repack", "-d", "-l", "-q", "--geometric=2"}),
+        git({"prune", "--expire=2.weeks.ago"}),
+        git({"commit-graph", "write", "--reachable", "--split", "--changed-paths"}),
+    };
+    // Chunks of large files that no checkpoint refers to anymore, after thinning or deleted backups
+    if (QFileInfo::exists(ChunkStore::storeDir(RepoCache::findGitDir(dir)))) {
+        JobCommand chunkGc;
+        chunkGc.task = [](const QString &dir) {
+            const qint64 freed = ChunkStore::collectGarbage(dir, RepoCache::findGitDir(dir));
+            JobResult result;
+            result.exitCode = 0;
+            result.out = QByteArray::number(freed);
+            return result;
+        };
+        commands.append(chunkGc);
+    }
+    jobs.enqueue(dir, QStringLiteral("maintenance"), JobQueue::Priority::Low, commands, context,
+                 [this, dir, timer, callback](const QList<JobResult> &results) {
+                     bool ok = true;
+                     for (const JobResult &result : results) {
+                         if (!result.ok()) {
+                             qDebug() << "Maintenance step failed in" << dir << result.err;
+                             ok = false;
+                         }
+                     }
+                     const QString stamp = QString("%1 %2").arg(QDateTime::currentSecsSinceEpoch()).arg(timer->elapsed());
+                     jobs.enqueue(dir, QString(), JobQueue::Priority::Low, {git({"config", LastRunKey, stamp})}, this,
+                                  [](const QList<JobResult> &) {});
+                     callback(ok);
+                 });
+}
+
+void Maintenance::stats(const QString &dir, QObject *context, const StatsCallback &callback)
+{
+    jobs.enqueue(dir, QStringLiteral("stats"), JobQueue::Priority::High, statsCommands(), context,
+                 [callback](const QList<JobResult> &results) { callback(parseStats(results)); });
+}
+
+QList<JobCommand> Maintenance::statsCommands()
+{
+    return {
+        {"git", {"count-objects", "-v"}, {}},
+        {"git", {"for-each-ref", "--format=x", "refs/heads/bak_*"}, {}},
+        {"git", {"config", "--get", LastRunKey}, {}},
+    };
+}
+
+JobCommand Maintenance::git(const QStringList &args) const
+{
+    if (lowPriority.isEmpty()) {
+        return {"git", args, {}};
+    }
+    return {lowPriority.constFirst(), lowPriority.mid(1) + QStringList {"git"} + args, {}};
+}
+
+MaintenanceStats Maintenance::parseStats(const QList<JobResult> &results)
+{
+    MaintenanceStats stats;
+    stats.isRepo = results.value(0).ok();
+    if (!stats.isRepo) {
+        return stats;
+    }
+    // "count: 12", "size: 48" (KiB), "packs: 2", "size-pack: 1024" (KiB), ...
+    for (const QByteArray &line : results.at(0).out.split('\n')) {
+        const qsizetype colon = line.indexOf(": ");
+        if (colon < 0) {
+            continue;
+        }
+        const QByteArray key = line.left(colon);
+        const qint64 value = line.mid(colon + 2).toLongLong();
+        if (key == "count") {
+            stats.looseObjects = value;
+        } else if (key == "size") {
+            stats.looseBytes = value * 1024;
+        } else if (key == "packs") {
+            stats.packs = value;
+        } else if (key == "size-pack") {
+            stats.packBytes = value * 1024;
+        }
+    }
+    stats.backupBranches = results.value(1).out.count('\n');
+    // "<seconds since the epoch> <duration in ms>"
+    const QList<QByteArray> lastRun = results.value(2).out.trimmed().split(' ');
+    if (results.value(2).ok() && lastRun.size() == 2) {
+        stats.lastRun = QDateTime::fromSecsSinceEpoch(lastRun.at(0).toLongLong());
+        stats.lastRunMsecs = lastRun.at(1).toLongLong();
+    }
+    return stats;
+}
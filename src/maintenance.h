@@ -0,0 +1,73 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef MAINTENANCE_H
+#define MAINTENANCE_H
+
+#include <QDateTime>
+#include <QObject>
+
+#include <functional>
+
+#include "jobqueue.h"
+
+// Object store figures of a checkpoint repository, from "git count-objects -v"
+struct MaintenanceStats {
+    bool isRepo {false};
+    qint64 looseObjects {0};
+    qint64 looseBytes {0};
+    qint64 packs {0};
+    qint64 packBytes {0};
+    qint64 backupBranches {0}; // bak_* branches left by restores
+    QDateTime lastRun;         // invalid if maintenance never ran
+    qint64 lastRunMsecs {0};
+};
+
+// Keeps checkpoint repositories compact: packs refs, repacks geometrically, prunes unreachable loose
+// objects older than two weeks and writes a split commit-graph with changed-path Bloom filters. Git runs
+// under nice and idle I/O priority in a queue of its own, so snapshots and refreshes never wait behind it.
+// The time of the last run is kept in the repository (restore-gui.lastmaintenance), shared by every front end.
+class Maintenance : public QObject
+{
+    Q_OBJECT
+public:
+    using StatsCallback = std::function<void(const MaintenanceStats &)>;
+
+    explicit Maintenance(QObject *parent = nullptr);
+
+    // Never ran, last run longer ago than the "maintenance/intervalHours" setting, or many loose objects
+    [[nodiscard]] static bool isDue(const MaintenanceStats &stats);
+    void run(const QString &dir, QObject *context, const std::function<void(bool ok)> &callback);
+    void stats(const QString &dir, QObject *context, const StatsCallback &callback);
+
+    // Commands behind stats(), for callers that query a repository in a job of their own; parseStats()
+    // takes their results as the first ones of the job
+    [[nodiscard]] static QList<JobCommand> statsCommands();
+    [[nodiscard]] static MaintenanceStats parseStats(const QList<JobResult> &results);
+
+private:
+    JobQueue jobs;
+    QStringList lowPriority;
+
+    [[nodiscard]] JobCommand git(const QStringList &args) const;
+};
+
+#endif // MAINTENANCE_H
@@ -25,18 +25,31 @@
 #include <QDebug>
 #include <QDirIterator>
 #include <QPair>
-#include <QTextBlock>
 #include <QTextStream>
 #include <QtWidgets>
 
 #include "about.h"
+#include "changesmodel.h"
+#include "checkpointmodel.h"
+#include "dashboarddialog.h"
+#include "diffdialog.h"
+#include "filehistorydialog.h"
+#include "maintenance.h"
+#include "searchdialog.h"
+#include "trace.h"
 
 MainWindow::MainWindow(const QCommandLineParser &arg_parser, QWidget *parent)
     : QDialog(parent),
       ui(new Ui::MainWindow),
-      git(new Git(this))
+      git(new Git(this)),
+      changes(new ChangesModel(this)),
+      checkpoints(new CheckpointModel(git, this)),
+      maintenance(new Maintenance(this))
 {
     ui->setupUi(this);
+    changes->setPlaceholder(tr("*** No changes from latest checkpoint ***"));
+    ui->listChanges->setModel(changes);
+    ui->listCheckpoints->setModel(checkpoints);
     const auto &arg_list = arg_parser.positionalArguments();
     if (!arg_list.empty() && QFileInfo::exists(arg_list.first())) {
         currentDir.setPath(arg_list.first());
@@ -164,8 +177,29 @@ void MainWindow::createSnapshot()
                                                   QLineEdit::Normal, QString(), &isOk);
 
     if (isOk && !message.isEmpty()) {
-        if (ui->pushSnapshot->text() == tr("Create checkpoint for entire directory")) {
-            git->commit(listSelectedFiles(), message);
+        qint64 expectedFiles = 0;
+        Git::Profile profile = Git::Profile::Default;
+        if (!Git::isInitialized()) {
+            // Warn user before initializing git in large directories
+            QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+            const DirScanner::Result size = DirScanner::scan(QDir::currentPath());
+            QApplication::restoreOverrideCursor();
+            const QString estimate = Git::largeDirectoryEstimate(size);
+            if (!estimate.isEmpty()
+                && QMessageBox::No
+                       == QMessageBox::question(this, tr("Confirmation"),
+                                                tr("You are trying to snapshot a large folder (%1), are you sure? If "
+                                                   "you select 'Yes' it might take a long time to process.")
+                                                    .arg(estimate))) {
+                return;
+            }
+            expectedFiles = size.complete ? size.files : 0;
+            if (!estimate.isEmpty()) {
+                profile = Git::Profile::LargeDirectory;
+            }
+        }
+        if (git->commit(listSelectedFiles(), message, expectedFiles, profile)) {
+            git->applyRetentionIfDue();
         }
         listCheckpoints();
     }
@@ -174,7 +208,7 @@ void MainWindow::createSnapshot()
 void MainWindow::onDirChanged()
 {
     // Reset UI state
-    ui->listChanges->clear();
+    changes->clear();
     ui->pushRestore->setDisabled(true);
     ui->pushRestore->setText(tr("Restore to selected checkpoint"));
     ui->pushSnapshot->setText(tr("Create checkpoint for entire directory"));
@@ -197,13 +231,55 @@ void MainWindow::setConnections()
     // Directory and file operations
     connect(this, &MainWindow::dirChanged, this, &MainWindow::onDirChanged);
     connect(ui->editCurrentDir, &QLineEdit::editingFinished, this, &MainWindow::editCurrent_done);
-    connect(ui->listChanges, &QListWidget::customContextMenuRequested, this, &MainWindow::contextMenuChanges);
-    connect(ui->listCheckpoints, &QListWidget::itemSelectionChanged, this, &MainWindow::checkpointSelection_changed);
+    connect(ui->listChanges, &QListView::customContextMenuRequested, this, &MainWindow::contextMenuChanges);
+    connect(changes, &ChangesModel::selectedCountChanged, this, &MainWindow::updateSelectionButtons);
+    connect(ui->listCheckpoints->selectionModel(), &QItemSelectionModel::selectionChanged, this,
+            &MainWindow::checkpointSelection_changed);
+    connect(checkpoints, &CheckpointModel::firstPageLoaded, this, [this] {
+        if (checkpoints->isEmpty()) {
+            ui->pushRestore->setDisabled(true);
+            ui->pushRestore->setText(tr("Restore to selected checkpoint"));
+            ui->pushSnapshot->setText(tr("Create checkpoint for entire directory"));
+        } else {
+            // Any directory with checkpoints shows up in the dashboard
+            DashboardDialog::addTrackedDirectory(QDir::currentPath());
+        }
+        // Selecting the first row triggers checkpointSelection_changed()
+        ui->listCheckpoints->setCurrentIndex(checkpoints->index(0));
+    });
+
+    // Checkpoints made or restored elsewhere (scheduled job, terminal), coalesce git's burst of ref writes
+    refreshTimer.setSingleShot(true);
+    refreshTimer.setInterval(500);
+    connect(&refreshTimer, &QTimer::timeout, this, &MainWindow::listCheckpoints);
+    // Repository maintenance once the directory has been left alone for a while
+    maintenanceTimer.setSingleShot(true);
+    maintenanceTimer.setInterval(std::chrono::minutes(2));
+    connect(&maintenanceTimer, &QTimer::timeout, this, &MainWindow::runMaintenanceIfDue);
+    // Directories one click away (back, forward, up), once the current one has been listed
+    prefetchTimer.setSingleShot(true);
+    prefetchTimer.setInterval(std::chrono::seconds(1));
+    connect(&prefetchTimer, &QTimer::timeout, this, &MainWindow::prefetchNeighbours);
+    // Busy cursor during git operations
+    connect(git, &Git::commandStarted, this, [] { QApplication::setOverrideCursor(QCursor(Qt::BusyCursor)); });
+    connect(git, &Git::commandFinished, this, [] { QApplication::setOverrideCursor(QCursor(Qt::ArrowCursor)); });
+    connect(git, &Git::operationProgress, this, &MainWindow::showProgress);
+    connect(git, &Git::operationFinished, this, [this] {
+        if (progressDialog) {
+            progressDialog->reset();
+        }
+    });
+    connect(git, &Git::repositoryChanged, this, [this](const QString &dir) {
+        if (dir == QDir::currentPath()) {
+            refreshTimer.start();
+        }
+    });
 
     // Button clicks
     connect(ui->pushAbout, &QPushButton::clicked, this, &MainWindow::pushAbout_clicked);
     connect(ui->pushBack, &QPushButton::clicked, this, &MainWindow::pushBack_clicked);
     connect(ui->pushCD, &QPushButton::clicked, this, &MainWindow::pushCD_clicked);
+    connect(ui->pushDashboard, &QPushButton::clicked, this, &MainWindow::pushDashboard_clicked);
     connect(ui->pushCancel, &QPushButton::pressed, this, &MainWindow::close);
     // connect(ui->pushDelete, &QPushButton::pressed, this, &MainWindow::pushDelete_clicked);
     connect(ui->pushDiff, &QPushButton::pressed, this, &MainWindow::pushDiff_clicked);
@@ -212,6 +288,7 @@ void MainWindow::setConnections()
     connect(ui->pushRefresh, &QPushButton::clicked, this, &MainWindow::pushRefresh_clicked);
     connect(ui->pushRestore, &QPushButton::clicked, this, &MainWindow::restoreSnapshot);
     connect(ui->pushSchedule, &QPushButton::clicked, this, &MainWindow::pushSchedule_clicked);
+    connect(ui->pushSearch, &QPushButton::clicked, this, &MainWindow::pushSearch_clicked);
     connect(ui->pushSnapshot, &QPushButton::clicked, this, &MainWindow::createSnapshot);
     connect(ui->pushUp, &QPushButton::clicked, this, &MainWindow::pushUp_clicked);
 
@@ -221,217 +298,290 @@ void MainWindow::setConnections()
 
 void MainWindow::showDiff()
 {
-    QStringList files;
-    for (int i = 0; i < ui->listChanges->count(); i++) {
-        auto *item = qobject_cast<QCheckBox *>(ui->listChanges->itemWidget(ui->listChanges->item(i)));
-        if (item && item->isChecked()) {
-            files.append(item->text().section('\t', 1));
-        }
-    }
+    const QStringList files = changes->selectedPaths();
+    showDiffFrom(currentCommit(), files,
+                 files.isEmpty() ? tr("Current .. ") + ui->listCheckpoints->currentIndex().data().toString()
+                                 : files.join(" "));
+}
 
-    QDialog dialog(this);
-    dialog.setWindowTitle(files.isEmpty() ? tr("Current .. ") + ui->listCheckpoints->currentItem()->text()
-                                          : files.join(" "));
+void MainWindow::showDiffFrom(const QString &commit, const QStringList &files, const QString &title)
+{
+    DiffDialog dialog(this);
+    dialog.setWindowTitle(title);
 
-    auto *layout = new QVBoxLayout(&dialog);
-    auto *textEdit = new QPlainTextEdit(&dialog);
-    textEdit->setReadOnly(true);
-    layout->addWidget(textEdit);
-    dialog.resize(800, 600);
-    dialog.setLayout(layout);
-
-    const QString commit = ui->listCheckpoints->currentItem()->data(Qt::UserRole).toString();
-    QProcess proc;
-    QStringList args = {"diff", "--color=never", commit};
-    args.append(files);
-    proc.start("git", args);
-    if (!proc.waitForFinished()) {
-        textEdit->setPlainText(tr("Error running git diff command"));
+    // The dialog stays responsive while git works, the callbacks are dropped if it was closed first
+    const quint64 job = git->diffAsync(
+        commit, files, &dialog, [&dialog](const QByteArray &chunk) { dialog.appendOutput(chunk); },
+        [&dialog](bool ok, const QString &error) { dialog.finish(ok, error); }, dialog.fileLimit());
+
+    dialog.exec();
+    git->cancelJob(job);
+}
+
+// Restore one file from a checkpoint found outside of the checkpoint list, e.g. by a search
+void MainWindow::restoreFile(const QString &commit, const QString &path)
+{
+    const auto response = QMessageBox::question(
+        this, tr("Confirmation"),
+        tr("Do you want to restore %1 from checkpoint %2? Any changes that were not in a checkpoint will be lost.")
+            .arg(path, commit.left(7)));
+    if (response != QMessageBox::Yes) {
         return;
     }
-    const QByteArray output = proc.readAllStandardOutput();
-    const QByteArray error = proc.readAllStandardError();
-    if (proc.exitCode() != 0) {
-        textEdit->setPlainText(tr("Git diff failed:\n%1").arg(QString::fromUtf8(error)));
-        return;
+    if (git->revertFiles(commit, {path})) {
+        QMessageBox::information(this, tr("Success"),
+                                 tr("%1 was restored from checkpoint %2").arg(path, commit.left(7)));
     }
-    textEdit->setPlainText(QString::fromUtf8(output));
-
-    QFont font(QStringLiteral("monospace"));
-    font.setStyleHint(QFont::Monospace);
-    dialog.setFont(font);
-
-    // Define text formats for diff highlighting
-    QTextCharFormat addedFormat;
-    addedFormat.setForeground(Qt::darkGreen);
-    addedFormat.setFontWeight(QFont::Bold);
-
-    QTextCharFormat locationFormat;
-    locationFormat.setForeground(QColor(35, 140, 216));
-    locationFormat.setFontWeight(QFont::Bold);
-
-    QTextCharFormat removedFormat;
-    removedFormat.setForeground(QColor(187, 15, 30));
-    removedFormat.setFontWeight(QFont::Bold);
-
-    // Apply syntax highlighting
-    QTextCursor cursor(textEdit->document());
-    cursor.setPosition(0);
-    while (!cursor.atEnd()) {
-        const QString lineText = cursor.block().text();
-        if (lineText.startsWith("@@")) {
-            while (!cursor.atBlockEnd()) {
-                cursor.movePosition(QTextCursor::NextWord, QTextCursor::KeepAnchor);
-                const QString selectedWord = cursor.selectedText();
-                if (selectedWord.contains(QRegularExpression("@@.*@@"))) {
-                    break;
-                }
-            }
-            cursor.mergeCharFormat(locationFormat);
-        } else if (lineText.startsWith('+')) {
-            cursor.movePosition(QTextCursor::EndOfLine, QTextCursor::KeepAnchor);
-            cursor.mergeCharFormat(addedFormat);
-        } else if (lineText.startsWith('-')) {
-            cursor.movePosition(QTextCursor::EndOfLine, QTextCursor::KeepAnchor);
-            cursor.mergeCharFormat(removedFormat);
-        }
-        cursor.movePosition(QTextCursor::NextBlock, QTextCursor::MoveAnchor);
-    }
-
-    cursor.setPosition(0);
-    dialog.exec();
-    dialog.adjustSize();
+    listCheckpoints();
 }
 
 void MainWindow::checkpointSelection_changed()
 {
+    const Trace::Span span("ui", QStringLiteral("checkpointSelection_changed"));
     ui->pushRestore->setText(tr("Restore to selected checkpoint"));
     ui->pushSnapshot->setText(tr("Create checkpoint for entire directory"));
 
-    const auto selectedItems = ui->listCheckpoints->selectedItems();
-    if (!selectedItems.isEmpty() && selectedItems.at(0)->text() != tr("No checkpoints")) {
-        ui->listChanges->clear();
-        const auto list = git->getStatus(selectedItems.at(0)->data(Qt::UserRole).toString());
-        if (!list.isEmpty()) {
-            displayChanges(list);
+    const QString commit = currentCommit();
+    if (!commit.isEmpty()) {
+        changes->clear();
+        // Wait for the worktree scan, its callback calls back in here
+        if (worktree) {
+            // A newer selection supersedes the pending status job
+            git->getStatusAsync(commit, *worktree, this,
+                                [this, commit, start = Trace::now()](const ChangeList &list) {
+                                    displayChanges(list);
+                                    updateRestoreButtons();
+                                    Trace::complete("ui", QStringLiteral("checkpoint selected to changes shown"), start,
+                                                    {{"commit", commit}, {"changes", static_cast<qint64>(list.size())}});
+                                });
         }
     }
+    updateRestoreButtons();
+}
 
-    const bool noChanges = ui->listChanges->count() == 0
-                           || ui->listChanges->item(0)->text() == tr("*** No changes from latest checkpoint ***");
+void MainWindow::updateRestoreButtons()
+{
+    const bool noChanges = !changes->hasChanges();
 
     ui->pushRestore->setDisabled(noChanges);
     ui->pushDiff->setDisabled(noChanges);
 }
 
-bool MainWindow::anyFileSelected()
+void MainWindow::updateSelectionButtons()
 {
-    for (int row = 0; row < ui->listChanges->count(); ++row) {
-        auto *check = qobject_cast<QCheckBox *>(ui->listChanges->itemWidget(ui->listChanges->item(row)));
-        if (check != nullptr && check->checkState() == Qt::Checked) {
-            return true;
-        }
-    }
-    return false;
+    const bool hasSelected = changes->selectedCount() > 0;
+    ui->pushSnapshot->setText(hasSelected ? tr("Create checkpoint for selected files")
+                                          : tr("Create checkpoint for entire directory"));
+    ui->pushRestore->setText(hasSelected ? tr("Restore selected files") : tr("Restore to selected checkpoint"));
 }
 
-QVector<QPair<QString, QString>> MainWindow::splitLog(const QStringList &log)
+// Empty for the "No checkpoints" placeholder and for rows whose page is still loading
+QString MainWindow::currentCommit() const
 {
-    QVector<QPair<QString, QString>> result;
-    result.reserve(log.size());
-
-    for (const QString &item : log) {
-        const QStringList parts = item.split('|');
-        if (parts.size() >= 2) {
-            result.append(qMakePair(parts.at(0), parts.at(1)));
-        }
-    }
-    return result;
+    const QModelIndexList selected = ui->listCheckpoints->selectionModel()->selectedIndexes();
+    return selected.isEmpty() ? QString() : selected.constFirst().data(CheckpointModel::CommitRole).toString();
 }
 
-void MainWindow::displayChanges(const QStringList &list)
+// Snapshots and restores run in a nested event loop, the dialog stays live while git works
+void MainWindow::showProgress(const OperationProgress &progress)
 {
-    ui->listChanges->clear();
-    for (const auto &file : list) {
-        if (file.isEmpty()) {
-            continue;
-        }
-        auto *item = new QListWidgetItem(ui->listChanges);
-        auto *check = new QCheckBox(file);
-        ui->listChanges->setItemWidget(item, check);
-
-        connect(check, &QCheckBox::clicked, [this, check] {
-            const bool isChecked = check->checkState() == Qt::Checked;
-            const bool hasSelected = isChecked || anyFileSelected();
-
-            ui->pushSnapshot->setText(hasSelected ? tr("Create checkpoint for selected files")
-                                                  : tr("Create checkpoint for entire directory"));
-            ui->pushRestore->setText(hasSelected ? tr("Restore selected files") : tr("Restore to selected checkpoint"));
-        });
+    if (!progressDialog) {
+        progressDialog = new QProgressDialog(this);
+        progressDialog->setWindowTitle(tr("Please wait"));
+        progressDialog->setWindowModality(Qt::WindowModal);
+        progressDialog->setMinimumDuration(500);
+        progressDialog->setAutoClose(false);
+        progressDialog->setAutoReset(false);
+        progressDialog->setMinimumWidth(400);
+        connect(progressDialog, &QProgressDialog::canceled, git, &Git::cancelOperation);
+    }
+    QString label = progress.phase;
+    if (progress.files > 0) {
+        label += '\n'
+                 + (progress.totalFiles > 0 ? tr("%1 of %2 files").arg(progress.files).arg(progress.totalFiles)
+                                            : tr("%n file(s)", nullptr, static_cast<int>(progress.files)));
+    }
+    if (progress.bytes > 0) {
+        label += ", " + QLocale().formattedDataSize(progress.bytes);
     }
+    progressDialog->setLabelText(label);
+    progressDialog->setCancelButtonText(progress.cancelable ? tr("Cancel") : QString());
+    // Unknown totals show a busy indicator
+    const auto clamp = [](qint64 value) { return static_cast<int>(std::min<qint64>(value, std::numeric_limits<int>::max())); };
+    progressDialog->setMaximum(clamp(progress.totalFiles));
+    progressDialog->setValue(clamp(std::min(progress.files, progress.totalFiles)));
+}
 
-    if (ui->listChanges->count() == 0) {
-        ui->listChanges->addItem(tr("*** No changes from latest checkpoint ***"));
+void MainWindow::displayChanges(const ChangeList &list)
+{
+    Trace::Span span("ui", QStringLiteral("displayChanges"));
+    span.setArg("changes", static_cast<qint64>(list.size()));
+    changes->setChanges(list);
+    if (!changes->hasChanges()) {
         ui->pushDiff->setDisabled(true);
     }
 }
 
 QStringList MainWindow::listSelectedFiles()
 {
-    QStringList selected;
-    selected.reserve(ui->listChanges->count());
-
-    for (int row = 0; row < ui->listChanges->count(); ++row) {
-        auto *check = qobject_cast<QCheckBox *>(ui->listChanges->itemWidget(ui->listChanges->item(row)));
-        if (check != nullptr && check->checkState() == Qt::Checked) {
-            selected << check->text().section("\t", 1);
-        }
-    }
-    return selected;
+    return changes->selectedPaths();
 }
 
 void MainWindow::listCheckpoints()
 {
-    ui->listCheckpoints->clear();
-    ui->listChanges->clear();
-
-    const QStringList list = git->listCommits();
-    const QVector<QPair<QString, QString>> pairList = splitLog(list);
+    const Trace::Span span("ui", QStringLiteral("listCheckpoints"));
+    refreshTimer.stop();
+    // Show the changes from the last scan right away, the fresh scan below replaces them if they differ
+    worktree = git->cachedWorktree();
+    changes->clear();
+
+    // Work queued for a directory we left is stale now
+    git->cancelOtherDirectories(QDir::currentPath());
+
+    // Only the first page is read now, the rest as the list is scrolled
+    checkpoints->reload();
+
+    // One scan of the working tree serves the snapshot button and every checkpoint selection
+    git->scanWorktreeAsync(this, [this, start = Trace::now()](const WorktreeStatus &status) {
+        Trace::complete("ui", QStringLiteral("listCheckpoints to worktree scanned"), start,
+                        {{"tracked", static_cast<qint64>(status.tracked.size())},
+                         {"untracked", static_cast<qint64>(status.untracked.size())}});
+        const bool unchanged = worktree == status;
+        worktree = status;
+        const bool hasModifiedFiles = status.hasModifications();
+        ui->pushSnapshot->setDisabled(!hasModifiedFiles);
+        ui->pushSnapshot->setToolTip(
+            hasModifiedFiles ? QString()
+                             : tr("No changes since last checkpoint, there's no need to create another checkpoint"));
+        if (!unchanged) {
+            checkpointSelection_changed();
+        }
+        if (status.isRepo) {
+            // Not from inside the callback, the question opens a nested event loop
+            QTimer::singleShot(0, this, &MainWindow::offerLargeProfile);
+        }
+    });
+    updateMaintenanceStats();
+    maintenanceTimer.start();
+    prefetchTimer.start();
+}
 
-    if (!list.isEmpty()) {
-        for (const QPair<QString, QString> &pair : pairList) {
-            auto *item = new QListWidgetItem(pair.second);
-            item->setData(Qt::UserRole, pair.first);
-            ui->listCheckpoints->addItem(item);
+void MainWindow::prefetchNeighbours()
+{
+    constexpr int depth = 3;
+    QStringList dirs;
+    const auto addLast = [&dirs](const QStack<QString> &stack) {
+        for (qsizetype i = stack.size() - 1; i >= 0 && i >= stack.size() - depth - 1; --i) {
+            if (!dirs.contains(stack.at(i))) {
+                dirs.append(stack.at(i));
+            }
         }
-    } else {
-        ui->listCheckpoints->insertItem(0, tr("No checkpoints"));
-        ui->pushRestore->setDisabled(true);
-        ui->pushRestore->setText(tr("Restore to selected checkpoint"));
-        ui->pushSnapshot->setText(tr("Create checkpoint for entire directory"));
+    };
+    addLast(history); // its top is the current directory
+    addLast(backHistory);
+    QDir parent(currentDir);
+    if (parent.cdUp() && !dirs.contains(parent.path())) {
+        dirs.append(parent.path());
     }
+    git->prefetch(dirs, CheckpointModel::PageSize);
+}
 
-    ui->listCheckpoints->setCurrentRow(0);
+void MainWindow::runMaintenanceIfDue()
+{
+    const QString dir = QDir::currentPath();
+    maintenance->stats(dir, this, [this, dir](const MaintenanceStats &stats) {
+        if (!Maintenance::isDue(stats) || dir != QDir::currentPath()) {
+            return;
+        }
+        ui->labelMaintenance->setText(tr("Optimizing checkpoint storage..."));
+        maintenance->run(dir, this, [this, dir](bool) {
+            if (dir == QDir::currentPath()) {
+                updateMaintenanceStats();
+            }
+        });
+    });
+}
 
-    const bool hasModifiedFiles = git->hasModifiedFiles();
-    ui->pushSnapshot->setDisabled(!hasModifiedFiles);
-    ui->pushSnapshot->setToolTip(
-        hasModifiedFiles ? QString()
-                         : tr("No changes since last checkpoint, there's no need to create another checkpoint"));
+void MainWindow::updateMaintenanceStats()
+{
+    const QString dir = QDir::currentPath();
+    maintenance->stats(dir, this, [this, dir](const MaintenanceStats &stats) {
+        if (dir != QDir::currentPath()) {
+            return;
+        }
+        if (!stats.isRepo) {
+            ui->labelMaintenance->clear();
+            ui->labelMaintenance->setToolTip(QString());
+            return;
+        }
+        const QLocale locale;
+        ui->labelMaintenance->setText(tr("Checkpoint storage: %1 packed, %2 loose objects (%3)")
+                                          .arg(locale.formattedDataSize(stats.packBytes))
+                                          .arg(stats.looseObjects)
+                                          .arg(locale.formattedDataSize(stats.looseBytes)));
+        const QString lastRun = stats.lastRun.isValid()
+                                    ? tr("%1, took %2 s")
+                                          .arg(locale.toString(stats.lastRun, QLocale::ShortFormat))
+                                          .arg(stats.lastRunMsecs / 1000.0, 0, 'f', 1)
+                                    : tr("never");
+        ui->labelMaintenance->setToolTip(tr("Packs: %1\nBackup branches: %2\nLast optimized: %3")
+                                             .arg(stats.packs)
+                                             .arg(stats.backupBranches)
+                                             .arg(lastRun));
+    });
+}
 
-    checkpointSelection_changed();
+// Existing checkpoint repositories of large folders are offered the large folder settings once per session,
+// a "No" is remembered
+void MainWindow::offerLargeProfile()
+{
+    const QString dir = QDir::currentPath();
+    if (profileOffered.contains(dir)) {
+        return;
+    }
+    profileOffered.insert(dir);
+    const QStringList declined = settings.value(QStringLiteral("largeProfileDeclined")).toStringList();
+    if (declined.contains(dir) || Git::indexEntries() < Git::LargeFiles || git->hasLargeProfile()) {
+        return;
+    }
+    if (QMessageBox::question(this, tr("Large folder"),
+                              tr("This folder has %n files under checkpoint. Switch its checkpoints to settings for "
+                                 "large folders? Refreshing the list of changes will be faster.",
+                                 nullptr, static_cast<int>(Git::indexEntries())))
+        != QMessageBox::Yes) {
+        settings.setValue(QStringLiteral("largeProfileDeclined"), declined + QStringList {dir});
+        return;
+    }
+    QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+    const ProfileReport report = git->applyLargeProfile();
+    QApplication::restoreOverrideCursor();
+    if (!report.ok) {
+        QMessageBox::warning(this, tr("Large folder"), tr("Could not change the settings of this folder."));
+        return;
+    }
+    QMessageBox::information(this, tr("Large folder"),
+                             tr("Checking for changes took %1 ms before and takes %2 ms now.")
+                                 .arg(report.statusBeforeMs)
+                                 .arg(report.statusAfterMs));
+    listCheckpoints();
 }
 
 void MainWindow::contextMenuChanges(QPoint pos)
 {
-    QListWidgetItem *selectedItem = ui->listChanges->itemAt(pos);
-    if (selectedItem == nullptr) {
+    const QModelIndex index = ui->listChanges->indexAt(pos);
+    if (!index.isValid() || !changes->hasChanges()) {
         return;
     }
 
     QMenu contextMenu(this);
     QAction *actionDiff = contextMenu.addAction(tr("Show diff from selected checkpoint to current version"));
     connect(actionDiff, &QAction::triggered, this, &MainWindow::showDiff);
+    const QString path = changes->path(index.row());
+    QAction *actionHistory = contextMenu.addAction(tr("File history"));
+    connect(actionHistory, &QAction::triggered, this, [this, path] {
+        FileHistoryDialog dialog(git, path, this);
+        dialog.exec();
+    });
     contextMenu.exec(ui->listChanges->mapToGlobal(pos));
 }
 
@@ -461,9 +611,20 @@ void MainWindow::pushCD_clicked()
     }
 }
 
+void MainWindow::pushDashboard_clicked()
+{
+    auto *dialog = new DashboardDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    connect(dialog, &DashboardDialog::openRequested, this, [this](const QString &dir) {
+        currentDir.setPath(dir);
+        emit dirChanged();
+    });
+    dialog->show();
+}
+
 void MainWindow::pushDelete_clicked()
 {
-    const QString commitId = ui->listCheckpoints->currentItem()->data(Qt::UserRole).toString();
+    const QString commitId = currentCommit();
     git->stash();
     git->rebaseToPrevious(commitId);
     git->popStash();
@@ -475,6 +636,18 @@ void MainWindow::pushDiff_clicked()
     showDiff();
 }
 
+// Non-modal, so checkpoints can still be browsed while a long search runs
+void MainWindow::pushSearch_clicked()
+{
+    auto *dialog = new SearchDialog(currentCommit(), this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    connect(dialog, &SearchDialog::diffRequested, this, [this](const QString &commit, const QString &path) {
+        showDiffFrom(commit, {path}, tr("Current .. %1").arg(commit.left(7)) + "  " + path);
+    });
+    connect(dialog, &SearchDialog::restoreRequested, this, &MainWindow::restoreFile);
+    dialog->show();
+}
+
 void MainWindow::pushHelp_clicked()
 {
     const QString url = QStringLiteral("google.com");
@@ -520,19 +693,15 @@ void MainWindow::pushSchedule_clicked()
     QButtonGroup *buttonGroup = new QButtonGroup(&dialog);
     QString currentPattern;
 
+    // Entries written by older versions ran git through the shell directly
+    const QString scheduleFilter = QString("grep -e 'cd %1 && git add . && git commit -m \"Scheduled checkpoint\"' "
+                                           "-e 'restore-cli snapshot --dir %1 -m'")
+                                       .arg(currentDir.path());
     if (git->needElevation()) {
-        currentPattern = Cmd()
-                             .getOut("cat /etc/cron.d/restore-gui | grep 'cd " + currentDir.path()
-                                         + " && git add . && git commit -m "
-                                           "\"Scheduled checkpoint\"' | cut -d' ' -f1-5",
-                                     true, true)
-                             .trimmed();
+        currentPattern
+            = Cmd().getOut("cat /etc/cron.d/restore-gui | " + scheduleFilter + " | cut -d' ' -f1-5", true, true).trimmed();
     } else {
-        currentPattern = Cmd()
-                             .getOut("crontab -l | grep 'cd " + currentDir.path()
-                                         + " && git add . && git commit -m \"Scheduled checkpoint\"' | cut -d' ' -f1-5",
-                                     true)
-                             .trimmed();
+        currentPattern = Cmd().getOut("crontab -l | " + scheduleFilter + " | cut -d' ' -f1-5", true).trimmed();
     }
     if (currentPattern.startsWith("@reboot")) {
         currentPattern = "@reboot";
@@ -555,6 +724,14 @@ void MainWindow::pushSchedule_clicked()
     groupBox->setLayout(vbox);
     layout->addWidget(groupBox);
 
+    auto *thinning = new QCheckBox(tr("Thin out old checkpoints"), &dialog);
+    thinning->setToolTip(tr("Keep all checkpoints from the last day, one per hour for a week, one per day for a "
+                            "month and one per week after that"));
+    const bool wasThinning = Git::isInitialized() && git->retentionEnabled();
+    thinning->setChecked(wasThinning);
+    thinning->setEnabled(Git::isInitialized());
+    layout->addWidget(thinning);
+
     // Add buttons
     auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
     buttonBox->setCenterButtons(true);
@@ -592,7 +769,9 @@ void MainWindow::pushSchedule_clicked()
 
         // Remove existing schedule
         if (needElevation) {
-            success = cmd.runAsRoot(QString("sed -i '/cd %1/d' /etc/cron.d/restore-gui").arg(escapedPath));
+            success = cmd.runAsRoot(
+                QString("sed -i -e '/cd %1/d' -e '/restore-cli snapshot --dir %1 -m/d' /etc/cron.d/restore-gui")
+                    .arg(escapedPath));
 
             // Clean up empty cron file if it exists
             if (cmd.runAsRoot("[ -f /etc/cron.d/restore-gui ] && [ ! -s /etc/cron.d/restore-gui ]", nullptr, nullptr,
@@ -600,15 +779,17 @@ void MainWindow::pushSchedule_clicked()
                 cmd.procAsRoot("rm", {"-f", "/etc/cron.d/restore-gui"});
             }
         } else {
-            success = cmd.run(QString("crontab -l 2>/dev/null | grep -v 'cd %1 && git add . && git commit "
-                                      "-m \"Scheduled checkpoint\"' | crontab -")
+            success = cmd.run(QString("crontab -l 2>/dev/null | grep -v -e 'cd %1 && git add . && git commit "
+                                      "-m \"Scheduled checkpoint\"' -e 'restore-cli snapshot --dir %1 -m' | crontab -")
                                   .arg(currentPath));
         }
 
         // Add new schedule if not "none"
         if (selectedPattern != "none") {
-            const QString cronCommand = QString("%1 cd %2 && git add . && git commit -m \"Scheduled checkpoint\"")
-                                            .arg(selectedPattern, currentPath);
+            // restore-cli skips the checkpoint when nothing changed; system cron tables need the user field
+            const QString cronCommand
+                = QString("%1 %2/usr/bin/restore-cli snapshot --dir %3 -m \"Scheduled checkpoint\"")
+                      .arg(selectedPattern, needElevation ? QStringLiteral("root ") : QString(), currentPath);
 
             if (needElevation) {
                 success = cmd.runAsRoot(QString("echo '%1' | tee -a /etc/cron.d/restore-gui").arg(cronCommand));
@@ -630,6 +811,17 @@ void MainWindow::pushSchedule_clicked()
         msgBox.setText(message);
         msgBox.setIcon(success ? QMessageBox::Information : QMessageBox::Warning);
         msgBox.exec();
+
+        if (thinning->isChecked() != wasThinning) {
+            git->setRetentionEnabled(thinning->isChecked());
+            if (thinning->isChecked()) {
+                const RetentionReport report = git->applyRetention();
+                if (!report.ok) {
+                    QMessageBox::warning(this, tr("Error"), tr("Could not thin out the checkpoints."));
+                }
+                listCheckpoints();
+            }
+        }
     }
 }
 
@@ -657,26 +849,35 @@ void MainWindow::restoreSnapshot()
              "to recover those changes see 'git stash --help'");
 
     // Handle different restore scenarios
-    if (ui->listCheckpoints->currentRow() == 0) {
+    bool ok = false;
+    QString message = stashMessage;
+    if (ui->listCheckpoints->currentIndex().row() == 0) {
         // Restore to clean state
-        git->stash(listSelectedFiles());
-        QMessageBox::information(this, successTitle, stashMessage);
+        ok = git->stash(listSelectedFiles());
     } else {
-        const QString commitId = ui->listCheckpoints->currentItem()->data(Qt::UserRole).toString();
+        const QString commitId = currentCommit();
 
         if (ui->pushRestore->text() == tr("Restore to selected checkpoint")) {
-            // Reset entire repo to previous checkpoint
+            // Reset entire repo to previous checkpoint, the backup branch only exists if every step went through
             const QString backup = git->resetToCommit(commitId);
-            QMessageBox::information(this, successTitle,
-                                     tr("You switched to a previous checkpoint, all newer checkpoints were backed up "
-                                        "to a git branch named %1")
-                                         .arg(backup));
+            ok = !backup.isEmpty();
+            message = tr("You switched to a previous checkpoint, all newer checkpoints were backed up "
+                         "to a git branch named %1")
+                          .arg(backup);
         } else if (ui->pushRestore->text() == tr("Restore selected files")) {
             // Restore only selected files
-            git->revertFiles(commitId, listSelectedFiles());
-            QMessageBox::information(this, successTitle, stashMessage);
+            ok = git->revertFiles(commitId, listSelectedFiles());
         }
     }
+    if (ok) {
+        QMessageBox::information(this, successTitle, message);
+    } else if (git->wasCanceled()) {
+        QMessageBox::information(this, tr("Canceled"),
+                                 tr("The restore was canceled. Changes that were already stashed are listed by "
+                                    "'git stash list'."));
+    } else {
+        QMessageBox::critical(this, tr("Error"), tr("Could not restore the files, git reported an error."));
+    }
 
     listCheckpoints();
 }
@@ -27,11 +27,19 @@
 #include <QDir>
 #include <QMessageBox>
 #include <QProcess>
+#include <QSet>
 #include <QSettings>
 #include <QStack>
+#include <QTimer>
+
+#include <optional>
 
 #include "git.h"
 
+class ChangesModel;
+class CheckpointModel;
+class Maintenance;
+class QProgressDialog;
 class Git;
 
 namespace Ui
@@ -58,16 +66,20 @@ private slots:
     void pushAbout_clicked();
     void pushBack_clicked();
     void pushCD_clicked();
+    void pushDashboard_clicked();
     void pushDelete_clicked();
     void pushDiff_clicked();
     void pushForward_clicked();
     void pushHelp_clicked();
     void pushRefresh_clicked();
     void pushSchedule_clicked();
+    void pushSearch_clicked();
     void pushUp_clicked();
     void restoreSnapshot();
     void setConnections();
     void showDiff();
+    void showDiffFrom(const QString &commit, const QStringList &files, const QString &title);
+    void restoreFile(const QString &commit, const QString &path);
     void checkpointSelection_changed();
 
 signals:
@@ -76,17 +88,32 @@ signals:
 private:
     Ui::MainWindow *ui;
     Git *git;
+    ChangesModel *changes;
+    CheckpointModel *checkpoints;
     QProcess proc;
     QSettings settings;
     QStack<QString> history;
     QStack<QString> backHistory;
     QDir currentDir {QDir::current()};
+    std::optional<WorktreeStatus> worktree;
+    QTimer refreshTimer;
+    QTimer maintenanceTimer;
+    QTimer prefetchTimer;
+    Maintenance *maintenance;
+    QProgressDialog *progressDialog {nullptr};
+    QSet<QString> profileOffered;
 
     [[nodiscard]] QStringList listSelectedFiles();
-    [[nodiscard]] bool anyFileSelected();
     [[nodiscard]] bool checkGitConfig();
-    [[nodiscard]] static QVector<QPair<QString, QString>> splitLog(const QStringList &log);
-    void displayChanges(const QStringList &list);
+    [[nodiscard]] QString currentCommit() const;
+    void displayChanges(const ChangeList &list);
+    void offerLargeProfile();
+    void prefetchNeighbours();
+    void runMaintenanceIfDue();
+    void updateMaintenanceStats();
+    void showProgress(const OperationProgress &progress);
+    void updateRestoreButtons();
+    void updateSelectionButtons();
 };
 
 #endif
@@ -0,0 +1,294 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "repocache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+
+namespace
+{
+QString fileStamp(const QString &path)
+{
+    const QFileInfo info(path);
+    if (!info.exists()) {
+        return QStringLiteral("-");
+    }
+    return QString::number(info.lastModified().toMSecsSinceEpoch()) + ':' + QString::number(info.size());
+}
+
+QByteArray readSmallFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.read(4096).trimmed();
+}
+
+// Rough heap size of cached strings, enough to keep the total in bounds
+qsizetype listBytes(const QStringList &list)
+{
+    qsizetype bytes = list.size() * qsizetype(sizeof(QString));
+    for (const QString &item : list) {
+        bytes += item.size() * qsizetype(sizeof(QChar));
+    }
+    return bytes;
+}
+} // namespace
+
+RepoCache::RepoCache(QObject *parent)
+    : QObject(parent),
+      maxBytes(QSettings().value(QStringLiteral("cache/maxMiB"), 64).toLongLong() * 1024 * 1024)
+{
+    connect(&watcher, &QFileSystemWatcher::fileChanged, this, &RepoCache::pathChanged);
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, this, &RepoCache::pathChanged);
+}
+
+std::optional<QStringList> RepoCache::commits(const QString &dir, int skip, int count)
+{
+    const Entry *entry = validEntry(dir);
+    if (!entry || !entry->commitPages.contains({skip, count})) {
+        return std::nullopt;
+    }
+    return entry->commitPages.value({skip, count});
+}
+
+std::optional<ChangeList> RepoCache::treeDiff(const QString &dir, const QString &commit)
+{
+    const Entry *entry = validEntry(dir);
+    if (!entry || !entry->treeDiffs.contains(commit)) {
+        return std::nullopt;
+    }
+    return entry->treeDiffs.value(commit);
+}
+
+std::optional<WorktreeStatus> RepoCache::worktree(const QString &dir)
+{
+    const Entry *entry = validEntry(dir);
+    return entry ? entry->worktree : std::nullopt;
+}
+
+void RepoCache::setCommits(const QString &dir, int skip, int count, const QStringList &commits)
+{
+    Entry &entry = touch(dir);
+    if (!entry.gitDir.isEmpty()) {
+        entry.commitPages.insert({skip, count}, commits);
+        stored(dir, entry);
+    }
+}
+
+void RepoCache::setTreeDiff(const QString &dir, const QString &commit, const ChangeList &changes)
+{
+    Entry &entry = touch(dir);
+    if (!entry.gitDir.isEmpty()) {
+        entry.treeDiffs.insert(commit, changes);
+        stored(dir, entry);
+    }
+}
+
+void RepoCache::setWorktree(const QString &dir, const WorktreeStatus &status)
+{
+    Entry &entry = touch(dir);
+    if (!entry.gitDir.isEmpty()) {
+        entry.worktree = status;
+        stored(dir, entry);
+    }
+}
+
+void RepoCache::invalidate(const QString &dir)
+{
+    const QString gitDir = entries.value(dir).gitDir;
+    entries.remove(dir);
+    unwatch(gitDir);
+}
+
+// Account for what was just stored in entry, then evict the least recently used other directories
+// while the total is over the limit
+void RepoCache::stored(const QString &dir, Entry &entry)
+{
+    entry.bytes = 0;
+    for (const QStringList &page : std::as_const(entry.commitPages)) {
+        entry.bytes += listBytes(page);
+    }
+    for (const ChangeList &changes : std::as_const(entry.treeDiffs)) {
+        entry.bytes += changes.bytes();
+    }
+    if (entry.worktree) {
+        entry.bytes += entry.worktree->tracked.bytes() + entry.worktree->untracked.bytes();
+    }
+    qsizetype total = 0;
+    for (const Entry &each : std::as_const(entries)) {
+        total += each.bytes;
+    }
+    while (total > maxBytes && entries.size() > 1) {
+        auto oldest = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it.key() != dir && (oldest == entries.end() || it->lastUse < oldest->lastUse)) {
+                oldest = it;
+            }
+        }
+        if (oldest == entries.end()) {
+            break;
+        }
+        total -= oldest->bytes;
+        const QString gitDir = oldest->gitDir;
+        entries.erase(oldest);
+        unwatch(gitDir);
+    }
+}
+
+// Stop watching a repository no cached directory belongs to anymore
+void RepoCache::unwatch(const QString &gitDir)
+{
+    if (gitDir.isEmpty()) {
+        return;
+    }
+    for (const Entry &entry : std::as_const(entries)) {
+        if (entry.gitDir == gitDir) {
+            return;
+        }
+    }
+    const QStringList watched = watcher.files() + watcher.directories();
+    QStringList paths;
+    for (const QString &path : watched) {
+        if (path.startsWith(gitDir + '/')) {
+            paths.append(path);
+        }
+    }
+    if (!paths.isEmpty()) {
+        watcher.removePaths(paths);
+    }
+}
+
+// Existing entry for dir with everything that no longer matches the stamps dropped
+RepoCache::Entry *RepoCache::validEntry(const QString &dir)
+{
+    auto it = entries.find(dir);
+    if (it == entries.end() || it->gitDir.isEmpty()) {
+        return nullptr;
+    }
+    it->lastUse = ++useCount;
+    const QString head = headStamp(it->gitDir);
+    if (head != it->headStamp) {
+        it->headStamp = head;
+        it->commitPages.clear();
+        it->treeDiffs.clear();
+        it->worktree.reset();
+        it->bytes = 0;
+    }
+    const QString index = indexStamp(it->gitDir);
+    if (index != it->indexStamp) {
+        it->indexStamp = index;
+        it->worktree.reset();
+    }
+    return &it.value();
+}
+
+RepoCache::Entry &RepoCache::touch(const QString &dir)
+{
+    if (Entry *entry = validEntry(dir)) {
+        return *entry;
+    }
+    Entry &entry = entries[dir];
+    entry.lastUse = ++useCount;
+    entry.gitDir = findGitDir(dir);
+    if (!entry.gitDir.isEmpty()) {
+        entry.headStamp = headStamp(entry.gitDir);
+        entry.indexStamp = indexStamp(entry.gitDir);
+        watch(entry.gitDir);
+    }
+    return entry;
+}
+
+void RepoCache::watch(const QString &gitDir)
+{
+    const QStringList paths {gitDir + "/HEAD", gitDir + "/index", gitDir + "/packed-refs", gitDir + "/refs",
+                             gitDir + "/refs/heads"};
+    const QStringList watched = watcher.files() + watcher.directories();
+    for (const QString &path : paths) {
+        if (!watched.contains(path) && QFileInfo::exists(path)) {
+            watcher.addPath(path);
+        }
+    }
+}
+
+void RepoCache::pathChanged(const QString &path)
+{
+    const bool indexOnly = path.endsWith("/index");
+    QStringList moved;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->gitDir.isEmpty() || !path.startsWith(it->gitDir + '/')) {
+            continue;
+        }
+        it->worktree.reset();
+        if (!indexOnly) {
+            it->commitPages.clear();
+            it->treeDiffs.clear();
+            moved.append(it.key());
+        }
+        // git replaces these files by renaming a lock file over them, which drops the watch
+        watch(it->gitDir);
+    }
+    for (const QString &dir : std::as_const(moved)) {
+        emit headChanged(dir);
+    }
+}
+
+QString RepoCache::findGitDir(const QString &dir)
+{
+    QDir current(dir);
+    while (true) {
+        const QFileInfo dotGit(current.filePath(".git"));
+        if (dotGit.isDir()) {
+            return dotGit.absoluteFilePath();
+        }
+        if (dotGit.isFile()) {
+            // Linked worktree or submodule: "gitdir: <path>"
+            const QByteArray link = readSmallFile(dotGit.absoluteFilePath());
+            if (link.startsWith("gitdir: ")) {
+                return QDir(current.absolutePath()).absoluteFilePath(QString::fromUtf8(link.mid(8)));
+            }
+        }
+        if (!current.cdUp()) {
+            return {};
+        }
+    }
+}
+
+// HEAD content, the branch it points to and the ref containers, all without running git
+QString RepoCache::headStamp(const QString &gitDir)
+{
+    const QByteArray head = readSmallFile(gitDir + "/HEAD");
+    QString stamp = QString::fromUtf8(head);
+    if (head.startsWith("ref: ")) {
+        stamp += '|' + QString::fromUtf8(readSmallFile(gitDir + '/' + QString::fromUtf8(head.mid(5))));
+    }
+    return stamp + '|' + fileStamp(gitDir + "/packed-refs") + '|' + fileStamp(gitDir + "/refs/heads");
+}
+
+QString RepoCache::indexStamp(const QString &gitDir)
+{
+    return fileStamp(gitDir + "/index");
+}
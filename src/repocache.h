@@ -0,0 +1,90 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef REPOCACHE_H
+#define REPOCACHE_H
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QStringList>
+
+#include <optional>
+
+#include "statusengine.h"
+
+// Per-directory cache of what git reported. Pages of the commit list and checkpoint tree diffs are valid while
+// HEAD and the refs are unchanged, the worktree scan while the index is unchanged as well.
+// Stamps are re-checked on every lookup (a few stat calls) and a QFileSystemWatcher on
+// .git/HEAD, .git/index and .git/refs drops entries as soon as git touches them.
+// Directories are evicted least recently used first once the cached lists take more than the
+// "cache/maxMiB" setting (64 MiB by default).
+class RepoCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RepoCache(QObject *parent = nullptr);
+
+    [[nodiscard]] std::optional<QStringList> commits(const QString &dir, int skip, int count);
+    [[nodiscard]] std::optional<ChangeList> treeDiff(const QString &dir, const QString &commit);
+    [[nodiscard]] std::optional<WorktreeStatus> worktree(const QString &dir);
+    void setCommits(const QString &dir, int skip, int count, const QStringList &commits);
+    void setTreeDiff(const QString &dir, const QString &commit, const ChangeList &changes);
+    void setWorktree(const QString &dir, const WorktreeStatus &status);
+    void invalidate(const QString &dir);
+
+    // .git directory of the repository containing dir, empty if there is none
+    [[nodiscard]] static QString findGitDir(const QString &dir);
+
+signals:
+    // HEAD or a ref moved, the checkpoint list of dir is out of date
+    void headChanged(const QString &dir);
+
+private:
+    struct Entry {
+        QString gitDir;
+        QString headStamp;
+        QString indexStamp;
+        QHash<QPair<int, int>, QStringList> commitPages;
+        QHash<QString, ChangeList> treeDiffs;
+        std::optional<WorktreeStatus> worktree;
+        qsizetype bytes {0};
+        quint64 lastUse {0};
+    };
+
+    QHash<QString, Entry> entries;
+    QFileSystemWatcher watcher;
+    qsizetype maxBytes;
+    quint64 useCount {0};
+
+    Entry *validEntry(const QString &dir);
+    Entry &touch(const QString &dir);
+    void stored(const QString &dir, Entry &entry);
+    void unwatch(const QString &gitDir);
+    void pathChanged(const QString &path);
+    void watch(const QString &gitDir);
+
+    [[nodiscard]] static QString headStamp(const QString &gitDir);
+    [[nodiscard]] static QString indexStamp(const QString &gitDir);
+};
+
+#endif // REPOCACHE_H
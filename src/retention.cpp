@@ -0,0 +1,55 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "retention.h"
+
+#include <QDateTime>
+
+#include <unordered_set>
+
+std::vector<bool> Retention::select(const QList<qint64> &times, qint64 now, const Policy &policy)
+{
+    constexpr qint64 hour = 3600;
+    constexpr qint64 day = 24 * hour;
+    std::vector<bool> keep(times.size(), false);
+    // Tier and period of every kept checkpoint, the first (newest) one of a period wins
+    std::unordered_set<qint64> periods;
+    for (qsizetype i = 0; i < times.size(); ++i) {
+        const qint64 age = now - times.at(i);
+        if (i == 0 || age < policy.allHours * hour) {
+            keep[i] = true;
+            continue;
+        }
+        const QDate date = QDateTime::fromSecsSinceEpoch(times.at(i)).date();
+        qint64 period = 0;
+        if (age < policy.hourlyDays * day) {
+            period = (1LL << 60) | (times.at(i) / hour);
+        } else if (age < policy.dailyDays * day) {
+            period = (2LL << 60) | date.toJulianDay();
+        } else {
+            int year = 0;
+            const int week = date.weekNumber(&year);
+            period = (3LL << 60) | (year * 100LL + week);
+        }
+        keep[i] = periods.insert(period).second;
+    }
+    return keep;
+}
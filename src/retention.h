@@ -0,0 +1,43 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include <QList>
+
+#include <vector>
+
+// Which checkpoints to keep as they age: all of the last allHours, then the newest of every hour up to
+// hourlyDays, of every day up to dailyDays and of every week after that. The newest checkpoint is always kept.
+namespace Retention
+{
+struct Policy {
+    int allHours {24};
+    int hourlyDays {7};
+    int dailyDays {30};
+};
+
+// times are commit times in seconds since the epoch, newest first; the result has one flag per entry
+[[nodiscard]] std::vector<bool> select(const QList<qint64> &times, qint64 now, const Policy &policy = {});
+} // namespace Retention
+
+#endif // RETENTION_H
@@ -0,0 +1,201 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "searchdialog.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDir>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QLocale>
+#include <QMenu>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace
+{
+enum Column { PathColumn, LineColumn, TextColumn, FoundColumn };
+enum Role { CommitRole = Qt::UserRole, PathRole };
+
+QString blobKey(const QString &path, const QString &blob)
+{
+    return blob + '\n' + path;
+}
+} // namespace
+
+SearchDialog::SearchDialog(const QString &selectedCommit, QWidget *parent)
+    : QDialog(parent),
+      selectedCommit(selectedCommit),
+      editPattern(new QLineEdit(this)),
+      checkCase(new QCheckBox(tr("Match case"), this)),
+      checkWorkingTree(new QCheckBox(tr("Current files"), this)),
+      comboScope(new QComboBox(this)),
+      pushSearch(new QPushButton(tr("Search"), this)),
+      tree(new QTreeWidget(this)),
+      status(new QLabel(this))
+{
+    setWindowTitle(tr("Search checkpoints"));
+    editPattern->setPlaceholderText(tr("Text to find"));
+    checkWorkingTree->setChecked(true);
+    comboScope->addItem(tr("All checkpoints"));
+    if (!selectedCommit.isEmpty()) {
+        comboScope->addItem(tr("Selected checkpoint %1").arg(selectedCommit));
+    }
+    pushSearch->setDefault(true);
+
+    tree->setRootIsDecorated(false);
+    tree->setUniformRowHeights(true);
+    tree->setHeaderLabels({tr("File"), tr("Line"), tr("Text"), tr("Found in")});
+    tree->setContextMenuPolicy(Qt::CustomContextMenu);
+
+    connect(pushSearch, &QPushButton::clicked, this, &SearchDialog::startOrStop);
+    connect(editPattern, &QLineEdit::returnPressed, this, &SearchDialog::startOrStop);
+    connect(tree, &QTreeWidget::customContextMenuRequested, this, &SearchDialog::contextMenu);
+    connect(tree, &QTreeWidget::itemDoubleClicked, this, [this](QTreeWidgetItem *item) {
+        const QString commit = item->data(FoundColumn, CommitRole).toString();
+        if (!commit.isEmpty()) {
+            emit diffRequested(commit, item->data(PathColumn, PathRole).toString());
+        }
+    });
+    connect(&search, &ContentSearch::matchesFound, this, &SearchDialog::addMatches);
+    connect(&search, &ContentSearch::checkpointsFound, this, &SearchDialog::setCheckpoints);
+    connect(&search, &ContentSearch::progress, this, [this](qint64 scanned, qint64 total) {
+        status->setText(tr("Searching... %1 of %2 files and versions").arg(scanned).arg(total));
+    });
+    connect(&search, &ContentSearch::finished, this, &SearchDialog::searchFinished);
+
+    auto *options = new QHBoxLayout;
+    options->addWidget(editPattern, 1);
+    options->addWidget(comboScope);
+    options->addWidget(checkWorkingTree);
+    options->addWidget(checkCase);
+    options->addWidget(pushSearch);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addLayout(options);
+    layout->addWidget(tree);
+    layout->addWidget(status);
+    resize(900, 550);
+}
+
+void SearchDialog::startOrStop()
+{
+    if (running) {
+        search.cancel();
+        return;
+    }
+    if (editPattern->text().isEmpty()) {
+        return;
+    }
+    tree->clear();
+    rowsByBlob.clear();
+    ContentSearch::Options options;
+    options.pattern = editPattern->text();
+    options.caseSensitive = checkCase->isChecked();
+    options.workingTree = checkWorkingTree->isChecked();
+    options.commit = comboScope->currentIndex() == 1 ? selectedCommit : QString();
+    status->setText(tr("Searching..."));
+    setRunning(true);
+    search.start(QDir::currentPath(), options);
+}
+
+void SearchDialog::setRunning(bool running)
+{
+    this->running = running;
+    pushSearch->setText(running ? tr("Stop") : tr("Search"));
+    editPattern->setEnabled(!running);
+    comboScope->setEnabled(!running);
+    checkWorkingTree->setEnabled(!running);
+    checkCase->setEnabled(!running);
+}
+
+// One batch per file or blob, added in one go
+void SearchDialog::addMatches(const QList<SearchMatch> &matches)
+{
+    QList<QTreeWidgetItem *> items;
+    items.reserve(matches.size());
+    for (const SearchMatch &match : matches) {
+        auto *item = new QTreeWidgetItem(
+            {match.path, QString::number(match.line), match.text, match.blob.isEmpty() ? tr("current files") : "..."});
+        item->setData(PathColumn, PathRole, match.path);
+        item->setToolTip(TextColumn, match.text);
+        if (!match.blob.isEmpty()) {
+            rowsByBlob.insert(blobKey(match.path, match.blob), item);
+        }
+        items.append(item);
+    }
+    const bool first = tree->topLevelItemCount() == 0;
+    tree->addTopLevelItems(items);
+    if (first) {
+        tree->resizeColumnToContents(PathColumn);
+        tree->resizeColumnToContents(LineColumn);
+    }
+}
+
+void SearchDialog::setCheckpoints(const QString &path, const QString &blob, const QString &newest, int count)
+{
+    const QString text = tr("%1 (%n checkpoint(s))", nullptr, count).arg(newest.left(7));
+    const auto range = rowsByBlob.equal_range(blobKey(path, blob));
+    for (auto it = range.first; it != range.second; ++it) {
+        (*it)->setText(FoundColumn, text);
+        (*it)->setData(FoundColumn, CommitRole, newest);
+        (*it)->setToolTip(FoundColumn, tr("Newest checkpoint with this line: %1").arg(newest));
+    }
+}
+
+void SearchDialog::searchFinished(bool ok, bool truncated)
+{
+    setRunning(false);
+    // Versions only reachable from backup branches or the reflog have no checkpoint on the current branch
+    for (QTreeWidgetItem *item : std::as_const(rowsByBlob)) {
+        if (item->data(FoundColumn, CommitRole).isNull()) {
+            item->setText(FoundColumn, tr("older checkpoints"));
+        }
+    }
+    const int count = tree->topLevelItemCount();
+    if (!ok) {
+        status->setText(tr("Search stopped, %n line(s) found", nullptr, count));
+    } else if (truncated) {
+        status->setText(tr("First %n lines found, refine the search to see all", nullptr, count));
+    } else {
+        status->setText(tr("%n line(s) found", nullptr, count));
+    }
+}
+
+void SearchDialog::contextMenu(QPoint pos)
+{
+    QTreeWidgetItem *item = tree->itemAt(pos);
+    const QString commit = item ? item->data(FoundColumn, CommitRole).toString() : QString();
+    if (commit.isEmpty()) {
+        return;
+    }
+    const QString path = item->data(PathColumn, PathRole).toString();
+    QMenu menu(this);
+    connect(menu.addAction(tr("Show diff from checkpoint %1 to current version").arg(commit.left(7))),
+            &QAction::triggered, this, [this, commit, path] { emit diffRequested(commit, path); });
+    connect(menu.addAction(tr("Restore this file from checkpoint %1").arg(commit.left(7))), &QAction::triggered, this,
+            [this, commit, path] { emit restoreRequested(commit, path); });
+    menu.exec(tree->viewport()->mapToGlobal(pos));
+}
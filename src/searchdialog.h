@@ -0,0 +1,73 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef SEARCHDIALOG_H
+#define SEARCHDIALOG_H
+
+#include <QDialog>
+#include <QMultiHash>
+
+#include "contentsearch.h"
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Search panel for text in the current files and in checkpoints, results are listed while the search runs.
+// Lines found in a checkpoint lead to the diff from the newest checkpoint containing them, or to restoring
+// the file from it.
+class SearchDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    // selectedCommit is the checkpoint selected in the main window, empty if there is none
+    explicit SearchDialog(const QString &selectedCommit, QWidget *parent = nullptr);
+
+signals:
+    void diffRequested(const QString &commit, const QString &path);
+    void restoreRequested(const QString &commit, const QString &path);
+
+private:
+    ContentSearch search;
+    QString selectedCommit;
+    QLineEdit *editPattern;
+    QCheckBox *checkCase;
+    QCheckBox *checkWorkingTree;
+    QComboBox *comboScope;
+    QPushButton *pushSearch;
+    QTreeWidget *tree;
+    QLabel *status;
+    QMultiHash<QString, QTreeWidgetItem *> rowsByBlob;
+    bool running {false};
+
+    void addMatches(const QList<SearchMatch> &matches);
+    void contextMenu(QPoint pos);
+    void setCheckpoints(const QString &path, const QString &blob, const QString &newest, int count);
+    void setRunning(bool running);
+    void startOrStop();
+    void searchFinished(bool ok, bool truncated);
+};
+
+#endif // SEARCHDIALOG_H
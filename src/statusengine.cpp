@@ -0,0 +1,263 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "statusengine.h"
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+
+namespace
+{
+using Status = ChangeList::Status;
+
+// Skip the first n space separated fields of a porcelain v2 record, the rest is the path
+QByteArrayView fieldsTail(QByteArrayView record, int n)
+{
+    qsizetype pos = 0;
+    for (int i = 0; i < n; ++i) {
+        pos = record.indexOf(' ', pos);
+        if (pos < 0) {
+            return {};
+        }
+        ++pos;
+    }
+    return record.sliced(pos);
+}
+
+// Net change between HEAD and the working tree from the index (X) and worktree (Y) columns
+std::optional<Status> netChange(char x, char y)
+{
+    if (y == 'D') {
+        return x == 'A' ? std::nullopt : std::optional(Status::Deleted);
+    }
+    if (x == 'A') {
+        return Status::Added;
+    }
+    if (x == 'D') {
+        return Status::Deleted;
+    }
+    if (x == 'T' || y == 'T') {
+        return Status::TypeChanged;
+    }
+    return Status::Modified;
+}
+
+Status fromLetter(char letter)
+{
+    switch (letter) {
+    case 'A':
+        return Status::Added;
+    case 'D':
+        return Status::Deleted;
+    case 'T':
+        return Status::TypeChanged;
+    case 'U':
+        return Status::Unmerged;
+    default:
+        return Status::Modified;
+    }
+}
+
+// Byte order, which for UTF-8 is code point order
+std::string_view byteOrder(QByteArrayView view)
+{
+    return {view.data(), static_cast<std::size_t>(view.size())};
+}
+
+// Calls f with every NUL terminated record of out, as views into it
+template <typename F>
+void forEachRecord(const QByteArray &out, F f)
+{
+    const QByteArrayView view(out);
+    qsizetype pos = 0;
+    while (pos < view.size()) {
+        qsizetype end = view.indexOf('\0', pos);
+        if (end < 0) {
+            end = view.size();
+        }
+        f(view.sliced(pos, end - pos));
+        pos = end + 1;
+    }
+}
+} // namespace
+
+QByteArrayView ChangeList::pathView(qsizetype i) const
+{
+    const auto row = static_cast<std::size_t>(i);
+    const qsizetype start = row == 0 ? 0 : ends[row - 1];
+    return QByteArrayView(paths).sliced(start, ends[row] - start);
+}
+
+qsizetype ChangeList::bytes() const
+{
+    return paths.capacity() + qsizetype(ends.capacity() * sizeof(qsizetype) + statuses.capacity() * sizeof(Status));
+}
+
+QStringList ChangeList::toLines() const
+{
+    QStringList lines;
+    lines.reserve(size());
+    for (qsizetype i = 0; i < size(); ++i) {
+        lines.append(code(status(i)) + '\t' + path(i));
+    }
+    return lines;
+}
+
+void ChangeList::append(Status status, QByteArrayView path)
+{
+    paths.append(path);
+    ends.push_back(paths.size());
+    statuses.push_back(status);
+}
+
+void ChangeList::reserve(qsizetype count, qsizetype pathBytes)
+{
+    paths.reserve(pathBytes);
+    ends.reserve(static_cast<std::size_t>(count));
+    statuses.reserve(static_cast<std::size_t>(count));
+}
+
+QString ChangeList::code(Status status)
+{
+    switch (status) {
+    case Status::Added:
+        return QStringLiteral("A");
+    case Status::Deleted:
+        return QStringLiteral("D");
+    case Status::Modified:
+        return QStringLiteral("M");
+    case Status::TypeChanged:
+        return QStringLiteral("T");
+    case Status::Unmerged:
+        return QStringLiteral("U");
+    case Status::Untracked:
+        return QStringLiteral("??");
+    }
+    return {};
+}
+
+// Records are read in place from the raw output, only the paths are copied (into the lists' buffers)
+WorktreeStatus StatusEngine::parseScan(const JobResult &result)
+{
+    WorktreeStatus status;
+    if (!result.ok()) {
+        return status;
+    }
+    status.isRepo = true;
+
+    bool renameSource = false;
+    forEachRecord(result.out, [&status, &renameSource](QByteArrayView record) {
+        if (renameSource) { // original path of a rename or copy
+            renameSource = false;
+            return;
+        }
+        if (record.size() < 2) {
+            return;
+        }
+        switch (record.at(0)) {
+        case '#':
+            if (record.startsWith("# branch.oid ") && !record.endsWith("(initial)")) {
+                status.headOid = QString::fromLatin1(record.sliced(13));
+            }
+            break;
+        case '1':
+        case '2':
+            if (const auto change = netChange(record.at(2), record.at(3))) {
+                status.tracked.append(*change, fieldsTail(record, record.at(0) == '1' ? 8 : 9));
+            }
+            renameSource = record.at(0) == '2';
+            break;
+        case 'u':
+            status.tracked.append(Status::Unmerged, fieldsTail(record, 10));
+            break;
+        case '?':
+            status.untracked.append(Status::Untracked, record.sliced(2));
+            break;
+        default:
+            break;
+        }
+    });
+    return status;
+}
+
+// "<letter>\0<path>\0" per change
+ChangeList StatusEngine::parseTreeDiff(const QByteArray &out)
+{
+    ChangeList changes;
+    std::optional<Status> pending;
+    forEachRecord(out, [&changes, &pending](QByteArrayView token) {
+        if (pending) {
+            changes.append(*pending, token);
+            pending.reset();
+        } else if (!token.isEmpty()) {
+            pending = fromLetter(token.at(0));
+        }
+    });
+    return changes;
+}
+
+// Compose checkpoint->HEAD with HEAD->worktree. A path touched by both is only known to differ
+// by existence; content that went back to the checkpoint's version is still reported as modified.
+// Both lists are merged through one sort of path views, no path is copied until the result is built.
+ChangeList StatusEngine::changesSince(const WorktreeStatus &worktree, const ChangeList &treeChanges)
+{
+    struct Item {
+        QByteArrayView path;
+        std::optional<Status> sinceCheckpoint;
+        std::optional<Status> sinceHead;
+    };
+    std::vector<Item> items;
+    items.reserve(static_cast<std::size_t>(treeChanges.size() + worktree.tracked.size()));
+    for (qsizetype i = 0; i < treeChanges.size(); ++i) {
+        items.push_back({treeChanges.pathView(i), treeChanges.status(i), std::nullopt});
+    }
+    for (qsizetype i = 0; i < worktree.tracked.size(); ++i) {
+        items.push_back({worktree.tracked.pathView(i), std::nullopt, worktree.tracked.status(i)});
+    }
+    std::stable_sort(items.begin(), items.end(),
+                     [](const Item &a, const Item &b) { return byteOrder(a.path) < byteOrder(b.path); });
+
+    ChangeList changes;
+    changes.reserve(static_cast<qsizetype>(items.size()) + worktree.untracked.size(),
+                    worktree.tracked.pathBytes() + treeChanges.pathBytes() + worktree.untracked.pathBytes());
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        Item item = items[i];
+        // The same path from both lists: the tree diff's entry sorts first
+        if (i + 1 < items.size() && byteOrder(items[i + 1].path) == byteOrder(item.path)) {
+            item.sinceHead = items[++i].sinceHead;
+        }
+        Status change = item.sinceCheckpoint ? *item.sinceCheckpoint : *item.sinceHead;
+        if (item.sinceCheckpoint && item.sinceHead) {
+            const bool inCheckpoint = *item.sinceCheckpoint != Status::Added;
+            const bool inWorktree = *item.sinceHead != Status::Deleted;
+            if (!inCheckpoint && !inWorktree) {
+                continue;
+            }
+            change = !inCheckpoint ? Status::Added : !inWorktree ? Status::Deleted : Status::Modified;
+        }
+        changes.append(change, item.path);
+    }
+    for (qsizetype i = 0; i < worktree.untracked.size(); ++i) {
+        changes.append(Status::Untracked, worktree.untracked.pathView(i));
+    }
+    return changes;
+}
@@ -0,0 +1,90 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef STATUSENGINE_H
+#define STATUSENGINE_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QStringList>
+
+#include <vector>
+
+#include "jobqueue.h"
+
+// Changed paths as flat arrays: a status per entry and the end offset of its path in one UTF-8 buffer,
+// filled straight from git's -z output. Paths are decoded to QString only when asked for (a row being
+// painted, a selection), so 100k changes cost a few allocations and no UTF-16 copy.
+class ChangeList
+{
+public:
+    enum class Status : quint8 { Added, Deleted, Modified, TypeChanged, Unmerged, Untracked };
+
+    [[nodiscard]] qsizetype size() const { return static_cast<qsizetype>(statuses.size()); }
+    [[nodiscard]] bool isEmpty() const { return statuses.empty(); }
+    [[nodiscard]] Status status(qsizetype i) const { return statuses[static_cast<std::size_t>(i)]; }
+    [[nodiscard]] QByteArrayView pathView(qsizetype i) const;
+    [[nodiscard]] QString path(qsizetype i) const { return QString::fromUtf8(pathView(i)); }
+    [[nodiscard]] qsizetype pathBytes() const { return paths.size(); }
+    // Heap memory held, for cache accounting
+    [[nodiscard]] qsizetype bytes() const;
+    // "X<tab>path" lines, for the command line
+    [[nodiscard]] QStringList toLines() const;
+    void append(Status status, QByteArrayView path);
+    void reserve(qsizetype count, qsizetype pathBytes);
+
+    // Letter shown for a status, "??" for untracked files
+    [[nodiscard]] static QString code(Status status);
+    bool operator==(const ChangeList &other) const = default;
+
+private:
+    QByteArray paths;
+    std::vector<qsizetype> ends;
+    std::vector<Status> statuses;
+};
+
+// Result of one "git status --porcelain=v2 -z" pass over the working tree.
+// Changes are relative to HEAD, untracked files are listed separately.
+struct WorktreeStatus {
+    bool isRepo {false};
+    QString headOid;
+    ChangeList tracked;
+    ChangeList untracked;
+
+    [[nodiscard]] bool hasModifications() const { return !isRepo || !tracked.isEmpty() || !untracked.isEmpty(); }
+    [[nodiscard]] bool isHead(const QString &commit) const
+    {
+        return !commit.isEmpty() && !headOid.isEmpty() && headOid.startsWith(commit);
+    }
+    bool operator==(const WorktreeStatus &other) const = default;
+};
+
+// Parses the single worktree scan (GitBackend::statusCommand) and derives the change list against any
+// checkpoint from it: changes since an older checkpoint are its tree diff to HEAD
+// (GitBackend::treeDiffCommand, no worktree walk) composed with the scan.
+namespace StatusEngine
+{
+[[nodiscard]] WorktreeStatus parseScan(const JobResult &result);
+[[nodiscard]] ChangeList parseTreeDiff(const QByteArray &out);
+[[nodiscard]] ChangeList changesSince(const WorktreeStatus &worktree, const ChangeList &treeChanges);
+} // namespace StatusEngine
+
+#endif // STATUSENGINE_H
@@ -0,0 +1,189 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QTextStream>
+
+#include <algorithm>
+#include <atomic>
+#include <unistd.h>
+
+namespace
+{
+struct Event {
+    const char *category;
+    QString name;
+    qint64 startUs;
+    qint64 durationUs;
+    qint64 thread;
+    QJsonObject args;
+};
+
+std::atomic<bool> recording {false};
+QElapsedTimer traceClock;
+QString traceFile;
+QMutex eventsMutex;
+QList<Event> events;
+
+void writeSummary()
+{
+    struct Total {
+        qsizetype count {0};
+        qint64 totalUs {0};
+        qint64 maxUs {0};
+    };
+    QHash<QString, Total> totals;
+    for (const Event &event : std::as_const(events)) {
+        Total &total = totals[QString::fromLatin1(event.category) + ' ' + event.name];
+        ++total.count;
+        total.totalUs += event.durationUs;
+        total.maxUs = std::max(total.maxUs, event.durationUs);
+    }
+    QList<QPair<QString, Total>> sorted;
+    for (auto it = totals.cbegin(); it != totals.cend(); ++it) {
+        sorted.append({it.key(), it.value()});
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second.maxUs > b.second.maxUs; });
+
+    QTextStream err(stderr);
+    err << QString("Trace with %1 spans written to %2\n").arg(events.size()).arg(traceFile);
+    err << QString("%1 %2 %3 %4\n")
+               .arg(QStringLiteral("max ms"), 10)
+               .arg(QStringLiteral("total ms"), 10)
+               .arg(QStringLiteral("count"), 7)
+               .arg(QStringLiteral("span"));
+    for (const auto &[name, total] : sorted.first(std::min<qsizetype>(sorted.size(), 20))) {
+        err << QString("%1 %2 %3 %4\n")
+                   .arg(total.maxUs / 1000.0, 10, 'f', 1)
+                   .arg(total.totalUs / 1000.0, 10, 'f', 1)
+                   .arg(total.count, 7)
+                   .arg(name);
+    }
+}
+
+// Runs when the application object is destroyed
+void finish()
+{
+    recording = false;
+    const QMutexLocker locker(&eventsMutex);
+    QJsonArray traceEvents;
+    traceEvents.append(QJsonObject {{"name", "process_name"},
+                                    {"ph", "M"},
+                                    {"pid", QCoreApplication::applicationPid()},
+                                    {"args", QJsonObject {{"name", QCoreApplication::applicationName()}}}});
+    for (const Event &event : std::as_const(events)) {
+        traceEvents.append(QJsonObject {{"name", event.name},
+                                        {"cat", event.category},
+                                        {"ph", "X"},
+                                        {"ts", event.startUs},
+                                        {"dur", event.durationUs},
+                                        {"pid", QCoreApplication::applicationPid()},
+                                        {"tid", event.thread},
+                                        {"args", event.args}});
+    }
+    QFile file(traceFile);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(QJsonDocument(QJsonObject {{"traceEvents", traceEvents}, {"displayTimeUnit", "ms"}}).toJson())
+               < 0) {
+        qWarning() << "Can't write trace" << traceFile << file.errorString();
+        return;
+    }
+    writeSummary();
+}
+} // namespace
+
+void Trace::start(const QString &fileName)
+{
+    const QString name = fileName.isEmpty() ? qEnvironmentVariable("RESTORE_GUI_TRACE") : fileName;
+    if (name.isEmpty() || recording) {
+        return;
+    }
+    traceFile = QFileInfo(name).absoluteFilePath();
+    traceClock.start();
+    recording = true;
+    qAddPostRoutine(finish);
+}
+
+bool Trace::enabled()
+{
+    return recording;
+}
+
+qint64 Trace::now()
+{
+    return recording ? traceClock.nsecsElapsed() / 1000 : 0;
+}
+
+void Trace::complete(const char *category, const QString &name, qint64 startUs, const QJsonObject &args)
+{
+    if (!recording) {
+        return;
+    }
+    const qint64 end = now();
+    const QMutexLocker locker(&eventsMutex);
+    events.append({category, name, startUs, end - startUs, gettid(), args});
+}
+
+QString Trace::commandName(const QString &program, const QStringList &args)
+{
+    const QString base = QFileInfo(program).fileName();
+    const auto command = std::find_if(args.cbegin(), args.cend(), [](const QString &arg) { return !arg.startsWith('-'); });
+    if (command == args.cend()) {
+        return base;
+    }
+    if (base == "bash" || base == "sh") {
+        return base + ": " + command->section(' ', 0, 0, QString::SectionSkipEmpty);
+    }
+    return base + ' ' + *command;
+}
+
+Trace::Span::Span(const char *category, const QString &name)
+    : category(category)
+{
+    if (recording) {
+        this->name = name;
+        startUs = now();
+    }
+}
+
+Trace::Span::~Span()
+{
+    if (active()) {
+        complete(category, name, startUs, args);
+    }
+}
+
+void Trace::Span::setArg(const QString &key, const QJsonValue &value)
+{
+    if (active()) {
+        args.insert(key, value);
+    }
+}
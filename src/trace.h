@@ -0,0 +1,63 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QJsonObject>
+#include <QStringList>
+
+// Timing spans for commands, queued jobs and GUI refreshes. Off unless started with --trace <file> or the
+// RESTORE_GUI_TRACE environment variable; then every span is kept in memory and written on exit as Chrome
+// trace-event JSON (open it in Perfetto or chrome://tracing), with a table of the slowest operations on stderr.
+namespace Trace
+{
+// Record to fileName, or to $RESTORE_GUI_TRACE if it is empty. Does nothing if both are empty.
+void start(const QString &fileName);
+[[nodiscard]] bool enabled();
+// Microseconds since start()
+[[nodiscard]] qint64 now();
+// A span that began at startUs (from now()) and ends now, for work finishing in a callback
+void complete(const char *category, const QString &name, qint64 startUs, const QJsonObject &args = {});
+// "git status" for git --literal-pathspecs status ..., "bash: crontab" for bash -c "crontab -l | ..."
+[[nodiscard]] QString commandName(const QString &program, const QStringList &args);
+
+// Scoped span, free when tracing is off
+class Span
+{
+public:
+    Span(const char *category, const QString &name);
+    ~Span();
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+    [[nodiscard]] bool active() const { return startUs >= 0; }
+    void setArg(const QString &key, const QJsonValue &value);
+
+private:
+    const char *category;
+    QString name;
+    QJsonObject args;
+    qint64 startUs {-1};
+};
+} // namespace Trace
+
+#endif // TRACE_H
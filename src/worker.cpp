@@ -0,0 +1,327 @@
+/**********************************************************************
+ *  worker.cpp
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+// Long-lived elevated worker, started once per session through pkexec and the helper script.
+// Reads framed requests from stdin and runs each one without a shell, see workerprotocol.h.
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "workerprotocol.h"
+
+namespace
+{
+
+struct Request {
+    uint32_t id {0};
+    std::vector<std::string> argv;
+    std::string cwd;
+    std::string input;
+};
+
+struct Response {
+    uint32_t id {0};
+    uint32_t exitCode {0};
+    std::string out;
+    std::string err;
+};
+
+bool readFull(int fd, char *buf, size_t len)
+{
+    while (len > 0) {
+        const ssize_t n = read(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeFull(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        const ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+uint32_t decodeU32(const char *p)
+{
+    const auto *u = reinterpret_cast<const unsigned char *>(p);
+    return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+}
+
+void appendU32(std::string &buf, uint32_t value)
+{
+    buf.push_back(static_cast<char>((value >> 24) & 0xff));
+    buf.push_back(static_cast<char>((value >> 16) & 0xff));
+    buf.push_back(static_cast<char>((value >> 8) & 0xff));
+    buf.push_back(static_cast<char>(value & 0xff));
+}
+
+// Cursor over a received frame, every read is bounds checked
+class FrameReader
+{
+public:
+    explicit FrameReader(const std::string &frame)
+        : data(frame)
+    {
+    }
+    bool u32(uint32_t &value)
+    {
+        if (data.size() - pos < 4) {
+            return false;
+        }
+        value = decodeU32(data.data() + pos);
+        pos += 4;
+        return true;
+    }
+    bool bytes(std::string &value)
+    {
+        uint32_t len {};
+        if (!u32(len) || data.size() - pos < len) {
+            return false;
+        }
+        value.assign(data, pos, len);
+        pos += len;
+        return true;
+    }
+
+private:
+    const std::string &data;
+    size_t pos {0};
+};
+
+bool readRequest(Request &request)
+{
+    char header[4];
+    if (!readFull(STDIN_FILENO, header, sizeof(header))) {
+        return false;
+    }
+    const uint32_t frameLen = decodeU32(header);
+    if (frameLen > WorkerProtocol::MaxFrameSize) {
+        return false;
+    }
+    std::string frame(frameLen, '\0');
+    if (!readFull(STDIN_FILENO, frame.data(), frameLen)) {
+        return false;
+    }
+
+    FrameReader reader(frame);
+    uint32_t argc {};
+    if (!reader.u32(request.id) || !reader.u32(argc) || argc == 0) {
+        return false;
+    }
+    request.argv.assign(argc, {});
+    for (auto &arg : request.argv) {
+        if (!reader.bytes(arg)) {
+            return false;
+        }
+    }
+    return reader.bytes(request.cwd) && reader.bytes(request.input);
+}
+
+bool writeResponse(const Response &response)
+{
+    if (response.out.size() + response.err.size() > WorkerProtocol::MaxOutputSize) {
+        return false;
+    }
+    std::string frame;
+    frame.reserve(20 + response.out.size() + response.err.size());
+    appendU32(frame, 0); // patched below
+    appendU32(frame, response.id);
+    appendU32(frame, response.exitCode);
+    appendU32(frame, static_cast<uint32_t>(response.out.size()));
+    frame += response.out;
+    appendU32(frame, static_cast<uint32_t>(response.err.size()));
+    frame += response.err;
+
+    std::string header;
+    appendU32(header, static_cast<uint32_t>(frame.size() - 4));
+    frame.replace(0, 4, header);
+    return writeFull(STDOUT_FILENO, frame.data(), frame.size());
+}
+
+// Run one request, feeding stdin and draining stdout/stderr concurrently so none of the pipes can deadlock
+Response execute(const Request &request)
+{
+    Response response;
+    int inPipe[2];
+    int outPipe[2];
+    int errPipe[2];
+    if (pipe2(inPipe, O_CLOEXEC) != 0 || pipe2(outPipe, O_CLOEXEC) != 0 || pipe2(errPipe, O_CLOEXEC) != 0) {
+        response.exitCode = WorkerProtocol::ExecFailed;
+        response.err = std::string("pipe: ") + strerror(errno);
+        return response;
+    }
+
+    std::vector<char *> argv;
+    argv.reserve(request.argv.size() + 1);
+    for (const auto &arg : request.argv) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        dup2(inPipe[0], STDIN_FILENO);
+        dup2(outPipe[1], STDOUT_FILENO);
+        dup2(errPipe[1], STDERR_FILENO);
+        // The worker ignores SIGPIPE for itself, commands get the default back (ignored dispositions survive exec)
+        signal(SIGPIPE, SIG_DFL);
+        if (!request.cwd.empty() && chdir(request.cwd.c_str()) != 0) {
+            const std::string msg = "chdir " + request.cwd + ": " + strerror(errno) + "\n";
+            writeFull(STDERR_FILENO, msg.data(), msg.size());
+            _exit(WorkerProtocol::ExecFailed);
+        }
+        execvp(argv.at(0), argv.data());
+        const std::string msg = "exec " + request.argv.at(0) + ": " + strerror(errno) + "\n";
+        writeFull(STDERR_FILENO, msg.data(), msg.size());
+        _exit(WorkerProtocol::ExecFailed);
+    }
+    close(inPipe[0]);
+    close(outPipe[1]);
+    close(errPipe[1]);
+    if (pid < 0) {
+        close(inPipe[1]);
+        close(outPipe[0]);
+        close(errPipe[0]);
+        response.exitCode = WorkerProtocol::ExecFailed;
+        response.err = std::string("fork: ") + strerror(errno);
+        return response;
+    }
+
+    int inFd = inPipe[1];
+    size_t written = 0;
+    if (request.input.empty()) {
+        close(inFd);
+        inFd = -1;
+    } else {
+        fcntl(inFd, F_SETFL, O_NONBLOCK);
+    }
+    int outFd = outPipe[0];
+    int errFd = errPipe[0];
+    char buf[65536];
+    bool tooLarge = false;
+
+    while (outFd >= 0 || errFd >= 0) {
+        pollfd fds[3] = {{outFd, POLLIN, 0}, {errFd, POLLIN, 0}, {inFd, POLLOUT, 0}};
+        if (poll(fds, 3, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (inFd >= 0 && (fds[2].revents & (POLLOUT | POLLERR | POLLHUP))) {
+            const ssize_t n = write(inFd, request.input.data() + written, request.input.size() - written);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+            }
+            if ((n < 0 && errno != EAGAIN && errno != EINTR) || written == request.input.size()) {
+                close(inFd);
+                inFd = -1;
+            }
+        }
+        const std::pair<int *, std::string *> readers[] = {{&outFd, &response.out}, {&errFd, &response.err}};
+        for (int i = 0; i < 2; ++i) {
+            if (*readers[i].first < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            const ssize_t n = read(*readers[i].first, buf, sizeof(buf));
+            if (n > 0) {
+                readers[i].second->append(buf, static_cast<size_t>(n));
+            } else if (n == 0 || errno != EINTR) {
+                close(*readers[i].first);
+                *readers[i].first = -1;
+            }
+        }
+        // Larger output can't be framed, stop the command rather than send a length that wraps around
+        if (!tooLarge && response.out.size() + response.err.size() > WorkerProtocol::MaxOutputSize) {
+            tooLarge = true;
+            kill(pid, SIGKILL);
+            for (int *fd : {&outFd, &errFd}) {
+                if (*fd >= 0) {
+                    close(*fd);
+                    *fd = -1;
+                }
+            }
+        }
+    }
+    if (inFd >= 0) {
+        close(inFd);
+    }
+
+    int status {};
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) { }
+    if (WIFEXITED(status)) {
+        response.exitCode = static_cast<uint32_t>(WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+        response.exitCode = static_cast<uint32_t>(128 + WTERMSIG(status));
+    }
+    if (tooLarge) {
+        response.exitCode = WorkerProtocol::ExecFailed;
+        response.out.clear();
+        response.err = "output of " + request.argv.at(0) + " exceeds " + std::to_string(WorkerProtocol::MaxOutputSize)
+                       + " bytes\n";
+    }
+    return response;
+}
+
+} // namespace
+
+int main()
+{
+    // A child closing its stdin early must not take the worker down
+    signal(SIGPIPE, SIG_IGN);
+
+    Request request;
+    while (readRequest(request)) {
+        Response response = execute(request);
+        response.id = request.id;
+        if (!writeResponse(response)) {
+            return 1;
+        }
+    }
+    return 0;
+}
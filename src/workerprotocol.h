@@ -0,0 +1,42 @@
+/**********************************************************************
+ *
+ **********************************************************************
+ * Copyright (C) 2025 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+#ifndef WORKERPROTOCOL_H
+#define WORKERPROTOCOL_H
+
+// Wire format shared by the elevated worker and its client (ElevatedWorker).
+// All integers are unsigned 32-bit big-endian, byte strings are length-prefixed.
+//
+// Request:  u32 frameLen | u32 id | u32 argc | argc * (u32 len, bytes) | u32 len, cwd | u32 len, stdin
+// Response: u32 frameLen | u32 id | u32 exitCode | u32 len, stdout | u32 len, stderr
+//
+// The id of a request is echoed in its response, so a client that sends another request while it waits
+// (from a nested event loop) can tell the answers apart. The worker exits when its stdin is closed. A command
+// whose output would not fit in a frame is killed and answered with ExecFailed.
+namespace WorkerProtocol
+{
+constexpr unsigned int MaxFrameSize = 1U << 30;
+// stdout and stderr of one response together, what is left of a frame after the four u32 fields
+constexpr unsigned int MaxOutputSize = MaxFrameSize - 16;
+constexpr int ExecFailed = 127;
+} // namespace WorkerProtocol
+
+#endif // WORKERPROTOCOL_H